@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <string_view>
@@ -28,8 +29,29 @@ using address_t = int64_t;
 using page_id_t = int64_t;
 using table_id_t = int64_t;
 using frame_id_t = int64_t;
-using space_t = string;
+// 表空间编号, 由 TableSpaceRegistry 按表空间文件名分配
+using space_t = uint32_t;
+
+#define STATIC_SINGLE_INSTANCE(type) \
+  static type* Instance() {          \
+    static type obj;                 \
+    return &obj;                     \
+  }
 
 #ifndef PAGE_SIZE
 #define PAGE_SIZE (16 * 1024)
+#endif
+
+/**
+ * @brief 表空间可选的页面大小范围, 页面大小为其间的2的幂,
+ * 未指定页面大小的表空间使用 PAGE_SIZE
+ */
+#define MIN_PAGE_SIZE (4 * 1024)
+#define MAX_PAGE_SIZE (64 * 1024)
+
+/**
+ * @brief 直接I/O要求的对齐大小, 页面大小必须是它的整数倍
+ */
+#ifndef IO_BLOCK_SIZE
+#define IO_BLOCK_SIZE 4096
 #endif
\ No newline at end of file
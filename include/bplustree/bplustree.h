@@ -4,19 +4,23 @@
 
 #include <iostream>
 #include <optional>
+#include <shared_mutex>
 #include <string_view>
+#include <unordered_map>
 
 #include "basetype.h"
 #include "bplustree/bplustree_page.h"
+#include "buffer/page_guard.h"
 #include "code.h"
 #include "file.h"
 
 using std::optional;
 using std::ostream;
+using std::shared_mutex;
 using std::string_view;
+using std::unordered_map;
 
 class File;
-class BufferedObjectMaker;
 class IBufferPool;
 class ISpaceManager;
 
@@ -26,14 +30,28 @@ struct BPlusTreeIndexMeta {
   address_t free;
   page_id_t max_page_id;
   uint32_t crc;
+  // 页面大小, 创建索引时确定; 旧版本的索引文件中为0, 即 PAGE_SIZE
+  uint32_t page_size;
 };
 
 ostream &operator<<(ostream &os, const BPlusTreeIndexMeta &meta);
 
 class BPlusTreeIndex {
  public:
+  /**
+   * @brief 打开或创建索引
+   *
+   * @param index_file_path 索引文件路径
+   * @param compare 比较器
+   * @param pool 缓冲池, 需要能缓存 page_size 大小的页面
+   * @param max_pinned_pages 常驻缓冲池的上层页面数量上限, 同时不超过
+   * 缓冲池能固定的页面数量的 1/PINNED_PAGES_FRACTION
+   * @param page_size 新建索引的页面大小, 打开已有索引时使用文件中保存的
+   */
   BPlusTreeIndex(const string &index_file_path, const Compare &compare,
-                 IBufferPool *pool);
+                 IBufferPool *pool,
+                 size_t max_pinned_pages = DEFAULT_MAX_PINNED_PAGES,
+                 uint32_t page_size = PAGE_SIZE);
   ~BPlusTreeIndex();
 
  public:
@@ -64,13 +82,78 @@ class BPlusTreeIndex {
   optional<string> Search(string_view key);
 
  private:
+  /**
+   * @brief 叶子页中的查找结果
+   *
+   * 乐观读取叶子页时, 定位叶子节点的同一遍中完成查找, 不再读取叶子页
+   */
+  struct LeafSearch {
+    bool done = false;
+    optional<string> value;
+  };
+
   /**
    * @brief 定位键所在的叶子节点
    *
    * @param key
+   * @param search 不为 nullptr 时, 乐观读取到叶子页后在其中查找键
+   * @return address_t
+   */
+  address_t LocateLeafNode(string_view key, LeafSearch *search = nullptr);
+
+  /**
+   * @brief 在内部页中定位键所在的孩子节点
+   *
+   * @param page 内部页
+   * @param key 键
    * @return address_t
    */
-  address_t LocateLeafNode(string_view key);
+  address_t LocateChild(const Page &page, string_view key);
+
+  /**
+   * @brief 常驻根节点和第二层内部页
+   *
+   * 常驻页面数量不超过 max_pinned_pages 和缓冲池能固定页面数量的
+   * 1/PINNED_PAGES_FRACTION, 留出足够的帧给其他页面.
+   * 只在打开索引和写操作结束时调用, 调用方不持有任何页面的锁
+   */
+  void PinUpperLevels();
+
+  /**
+   * @brief 释放常驻的上层页面, 调用方持有 pinned_lock_ 的排他锁
+   *
+   */
+  void UnpinUpperLevels();
+
+  /**
+   * @brief 从缓冲池中获取页面并持有读锁
+   *
+   * @param page_address 页面地址
+   * @return ReadPageGuard
+   */
+  ReadPageGuard ReadPage(address_t page_address);
+
+  /**
+   * @brief 乐观读取节点, 不固定页面也不持有帧的锁, 直接在帧上查找
+   *
+   * @param page_address 页面地址
+   * @param key 键
+   * @param child 内部页中键所在的孩子节点地址, 叶子页为0
+   * @param search 不为 nullptr 时在叶子页中查找键
+   * @return true 读取成功
+   * @return false 页面不在缓冲池中或与写者冲突, 调用方回退到固定页面读取
+   */
+  bool ReadNodeOptimistic(address_t page_address, string_view key,
+                          address_t *child, LeafSearch *search);
+
+  /**
+   * @brief 从缓冲池中获取页面并持有写锁, 释放时页面标记为脏页
+   *
+   * @param page_address 页面地址
+   * @param is_new 是否为新分配的页面, 新页面不从磁盘读取
+   * @return WritePageGuard
+   */
+  WritePageGuard WritePage(address_t page_address, bool is_new = false);
 
   ResultCode Insert(PageType page_type, address_t page_address, string_view key,
                     const vector<string_view> &vals);
@@ -91,20 +174,35 @@ class BPlusTreeIndex {
 /**
  * @brief 记录页地址
  *
+ * 第0页保留给索引元数据, 记录页从第1页开始, 保证页地址按页大小对齐.
+ * 直接I/O要求地址按 IO_BLOCK_SIZE 对齐, 缓冲池的批量读写和预热也按
+ * 页大小合并相邻页面. 记录页紧跟在元数据之后的旧格式索引文件不兼容.
  */
-#define BPLUSTREE_INDEX_PAGE_ADDRESS(page_id) \
-  (sizeof(BPlusTreeIndexMeta) + PAGE_SIZE * page_id)
+#define BPLUSTREE_INDEX_PAGE_ADDRESS(page_id, page_size) \
+  ((page_size) * ((page_id) + 1))
 
  public:
   void ScanLeafPage();
   void BFS();
 
+ public:
+  static const size_t DEFAULT_MAX_PINNED_PAGES = 128;
+  static const size_t PINNED_PAGES_FRACTION = 4;
+
  private:
-  File *file_;
   BPlusTreeIndexMeta *index_meta_;
   Compare comparator_;
   string index_file_path_;
-  BufferedObjectMaker *maker_;
+  // 索引文件注册的表空间编号
+  space_t space_;
+  uint32_t page_size_;
   ISpaceManager *space_manager_;
   IBufferPool *pool_;
+  // 常驻缓冲池的上层页面, 读者持有 pinned_lock_ 的共享锁查找,
+  // 写者重新固定时持有排他锁
+  unordered_map<address_t, Frame *> pinned_frames_;
+  shared_mutex pinned_lock_;
+  // 只由写操作读写
+  bool upper_levels_stale_;
+  size_t max_pinned_pages_;
 };
\ No newline at end of file
@@ -82,7 +82,27 @@ enum class PageCode {
  */
 class Page {
  public:
-  Page(PageType page_type, bool isLoad = false, char *buffer = nullptr);
+  /**
+   * @brief 构造页面
+   *
+   * @param page_type 页面类型
+   * @param isLoad 是否从已有的页面数据加载, 加载时页面大小取页面元数据
+   * @param buffer 页面数据, 为 nullptr 时分配 page_size 大小的内存
+   * @param page_size 新页面的大小
+   */
+  Page(PageType page_type, bool isLoad = false, char *buffer = nullptr,
+       uint32_t page_size = PAGE_SIZE);
+
+  /**
+   * @brief 加载只读页面, 只能调用不修改页面的方法
+   *
+   * 持有页面读锁时访问帧上的页面, 页面数据不会被修改
+   *
+   * @param page_type 页面类型
+   * @param buffer 页面数据
+   * @return const Page
+   */
+  static const Page ReadOnly(PageType page_type, const char *buffer);
 
  public:
   /**
@@ -217,6 +237,34 @@ class Page {
    * @return uint16_t
    */
   uint16_t LowerBound(string_view key, const Compare &compare) noexcept;
+  /**
+   * @brief 大于等于目标key的, 最小key, 不修改页面
+   *
+   * 只持有页面读锁时使用, 不记录命中的槽号
+   *
+   * @param key
+   * @param compare
+   * @return uint16_t
+   */
+  uint16_t UnmodifiedLowerBound(string_view key,
+                                const Compare &compare) const noexcept;
+  /**
+   * @brief 大于等于目标key的, 最小key, 用于乐观读取帧上的页面
+   *
+   * 页面可能正被写者改写, 与 UnmodifiedLowerBound 的查找过程相同, 但所有
+   * 槽、记录的偏移量和长度都核对不越过 page_size, 记录链表的遍历步数
+   * 也有上限. 页面不一致时返回 false, 由调用方核对版本号后重试.
+   *
+   * @param page_size 帧的大小, 页面元数据中的大小可能不一致
+   * @param key 键
+   * @param compare 比较函数
+   * @param record 找到的记录的键和值
+   * @return true 页面结构完整, record 有效
+   * @return false
+   */
+  bool OptimisticLowerBound(uint32_t page_size, string_view key,
+                            const Compare &compare,
+                            RecordData *record) const noexcept;
   /**
    * @brief 搜索小于目标key的,最大key
    *
@@ -292,7 +340,7 @@ class Page {
    * @param len 长度
    * @return string_view 视图
    */
-  string_view View(uint16_t offset, size_t len);
+  string_view View(uint16_t offset, size_t len) const;
 
   /**
    * @brief 整理页面
@@ -320,7 +368,7 @@ class Page {
   bool TryAlloc(uint16_t size) noexcept;
 
  public:
-  void scan_use() noexcept;
+  void scan_use() const noexcept;
   void scan_free() noexcept;
   void scan_slots() noexcept;
   void ScanData() noexcept;
@@ -338,13 +386,14 @@ class Page {
   template <typename T>
   const T *UnmodifiedAttribute(uint16_t offset) const;
 
-  string_view Key(uint16_t record_address);
-  string_view Value(uint16_t record_address);
+  string_view Key(uint16_t record_address) const;
+  string_view Value(uint16_t record_address) const;
 
   void move(uint16_t src_offset, uint16_t len, uint16_t dst_offset) noexcept;
 
  public:
   PageMeta *meta() { return meta_; }
+  const PageMeta *meta() const { return meta_; }
 
  public:
   PageMeta *meta_;
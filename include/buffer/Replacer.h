@@ -2,17 +2,23 @@
 #ifndef REPLACER_H
 #define REPLACER_H
 
+#include <atomic>
+#include <list>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 #include "basetype.h"
 #include "frame.h"
 
+using std::atomic;
+using std::list;
 using std::lock_guard;
 using std::mutex;
 using std::optional;
 using std::unordered_map;
+using std::vector;
 
 class IReplacer {
  public:
@@ -21,8 +27,45 @@ class IReplacer {
   virtual void Unpin(frame_id_t frame_id) = 0;
   virtual size_t size() = 0;
   virtual void scan() = 0;
+  virtual ~IReplacer() = default;
+
+  /**
+   * @brief 记录一次页面访问, 缓冲池在每次 FetchPage 命中或加载页面时调用
+   *
+   * 只按 Pin/Unpin 顺序淘汰的替换器不需要实现
+   *
+   * @param frame_id 帧
+   */
+  virtual void RecordAccess(frame_id_t) {}
+
+  /**
+   * @brief 记录帧上装入了新页面, 缓冲池在缺页加载时调用
+   *
+   * 默认视为一次访问
+   *
+   * @param frame_id 帧
+   * @param page_position 装入的页面
+   */
+  virtual void RecordLoad(frame_id_t frame_id, const PagePosition &) {
+    this->RecordAccess(frame_id);
+  }
+
+  /**
+   * @brief 按替换顺序导出帧, 最不容易被淘汰的帧在前
+   *
+   * 用于缓冲池预热时保存热点页面, 默认不导出
+   *
+   * @return vector<frame_id_t>
+   */
+  virtual vector<frame_id_t> Snapshot() { return {}; }
 };
 
+/**
+ * @brief 缓冲池的页面替换策略
+ *
+ */
+enum class ReplacerPolicy : uint8_t { kLRU = 0, kClock, kLRUK, kARC };
+
 template <typename T>
 struct LRUNode {
   LRUNode<T> *next;
@@ -43,6 +86,7 @@ class LRUReplacer : public IReplacer {
   virtual void Unpin(frame_id_t frame_id) override;
   virtual size_t size() override;
   virtual void scan() override;
+  virtual vector<frame_id_t> Snapshot() override;
 
  private:
   size_t size_;
@@ -53,4 +97,188 @@ class LRUReplacer : public IReplacer {
   unordered_map<frame_id_t, LRUNode<frame_id_t> *> nodes_;
 };
 
+/**
+ * @brief CLOCK(二次机会)替换器
+ *
+ * 每个帧在按 frame_id 索引的数组中占一个状态字节, 记录是否可淘汰以及
+ * 引用位. Pin/Unpin 只对状态字节做原子操作, 不分配内存也不查哈希表;
+ * Victim 移动时钟指针, 清除遇到的引用位, 淘汰第一个引用位为0的可淘汰帧.
+ *
+ * frame_id 必须小于构造时的容量.
+ */
+class ClockReplacer : public IReplacer {
+ public:
+  ClockReplacer(size_t capacity);
+  ClockReplacer(const ClockReplacer &other) = delete;
+  ClockReplacer(const ClockReplacer &&other) = delete;
+  virtual ~ClockReplacer();
+
+ public:
+  virtual optional<frame_id_t> Victim() override;
+  virtual void Pin(frame_id_t frame_id) override;
+  virtual void Unpin(frame_id_t frame_id) override;
+  virtual size_t size() override;
+  virtual void scan() override;
+  virtual vector<frame_id_t> Snapshot() override;
+
+ private:
+  static const uint8_t kEvictable = 1;
+  static const uint8_t kReferenced = 2;
+
+  size_t capacity_;
+  atomic<uint8_t> *states_;
+  atomic<size_t> hand_;
+  atomic<size_t> size_;
+};
+
+/**
+ * @brief LRU-K 替换器
+ *
+ * 按后向K距离淘汰: 访问次数不足K次的帧距离视为无穷大, 优先淘汰, 其中
+ * 最早访问的先淘汰; 其余帧淘汰第K次最近访问最早的帧. 只访问过一次的
+ * 扫描页面因此先于频繁访问的上层内部页被淘汰.
+ *
+ * 每个帧最近K次访问的时间戳保存在按 frame_id 索引的环形数组中,
+ * Victim 需要遍历所有帧.
+ */
+class LRUKReplacer : public IReplacer {
+ public:
+  LRUKReplacer(size_t capacity, size_t k = DEFAULT_K);
+  LRUKReplacer(const LRUKReplacer &other) = delete;
+  LRUKReplacer(const LRUKReplacer &&other) = delete;
+  virtual ~LRUKReplacer();
+
+ public:
+  virtual optional<frame_id_t> Victim() override;
+  virtual void Pin(frame_id_t frame_id) override;
+  virtual void Unpin(frame_id_t frame_id) override;
+  virtual size_t size() override;
+  virtual void scan() override;
+  virtual vector<frame_id_t> Snapshot() override;
+  virtual void RecordAccess(frame_id_t frame_id) override;
+
+ public:
+  static const size_t DEFAULT_K = 2;
+
+ private:
+  /**
+   * @brief 帧的第K次最近访问时间, 访问不足K次时为最早的访问时间
+   *
+   * @param frame_id 帧
+   * @return uint64_t
+   */
+  uint64_t KthAccess(frame_id_t frame_id) const;
+
+ private:
+  size_t capacity_;
+  size_t k_;
+  size_t size_;
+  uint64_t current_timestamp_;
+  // 每个帧占 k_ 个时间戳
+  uint64_t *history_;
+  uint64_t *access_count_;
+  bool *evictable_;
+  mutex lock_;
+};
+
+/**
+ * @brief ARC(自适应替换缓存)替换器
+ *
+ * 驻留帧分为只访问过一次的近期列表 T1 和访问过多次的频繁列表 T2,
+ * 被淘汰页面的位置分别进入幽灵列表 B1 和 B2. 缺页时命中 B1 说明近期列表
+ * 过小, 增大 T1 的目标长度; 命中 B2 则减小. 淘汰时 T1 超过目标长度就从
+ * T1 淘汰, 否则从 T2 淘汰, 从而在点查和扫描负载之间自动调整.
+ *
+ * 驻留列表是按 frame_id 索引的侵入式双向链表, 幽灵列表按页面位置索引.
+ * 被固定的帧仍留在列表中, 淘汰时跳过.
+ */
+class ARCReplacer : public IReplacer {
+ public:
+  ARCReplacer(size_t capacity);
+  ARCReplacer(const ARCReplacer &other) = delete;
+  ARCReplacer(const ARCReplacer &&other) = delete;
+  virtual ~ARCReplacer();
+
+ public:
+  virtual optional<frame_id_t> Victim() override;
+  virtual void Pin(frame_id_t frame_id) override;
+  virtual void Unpin(frame_id_t frame_id) override;
+  virtual size_t size() override;
+  virtual void scan() override;
+  virtual vector<frame_id_t> Snapshot() override;
+  virtual void RecordAccess(frame_id_t frame_id) override;
+  virtual void RecordLoad(frame_id_t frame_id,
+                          const PagePosition &page_position) override;
+
+  /**
+   * @brief 近期列表 T1 的目标长度
+   *
+   * @return size_t
+   */
+  size_t recency_target();
+
+ private:
+  enum ListType : uint8_t { kNone = 0, kRecency, kFrequency };
+
+  /**
+   * @brief 将帧插入列表的最近使用端
+   *
+   * @param frame_id 帧
+   * @param list_type 列表
+   */
+  void Link(frame_id_t frame_id, ListType list_type);
+
+  /**
+   * @brief 将帧从所在列表中移除
+   *
+   * @param frame_id 帧
+   */
+  void Unlink(frame_id_t frame_id);
+
+  /**
+   * @brief 列表中最久未使用的可淘汰帧
+   *
+   * @param list_type 列表
+   * @return optional<frame_id_t>
+   */
+  optional<frame_id_t> LeastRecentEvictable(ListType list_type);
+
+  /**
+   * @brief 控制幽灵列表长度: |T1|+|B1| 不超过容量, 四个列表总长不超过两倍容量
+   *
+   */
+  void TrimGhosts();
+
+ private:
+  size_t capacity_;
+  size_t size_;
+  size_t target_;
+
+  // 下标 capacity_ 和 capacity_+1 是两个驻留列表的哨兵
+  frame_id_t *prev_;
+  frame_id_t *next_;
+  ListType *lists_;
+  size_t list_size_[3];
+  bool *evictable_;
+  bool *has_position_;
+  PagePosition *positions_;
+
+  list<PagePosition> recency_ghosts_;
+  list<PagePosition> frequency_ghosts_;
+  unordered_map<PagePosition, list<PagePosition>::iterator>
+      recency_ghost_index_;
+  unordered_map<PagePosition, list<PagePosition>::iterator>
+      frequency_ghost_index_;
+  mutex lock_;
+};
+
+/**
+ * @brief 按替换策略创建替换器
+ *
+ * @param policy 替换策略
+ * @param capacity 缓冲帧数量
+ * @return IReplacer*
+ */
+IReplacer *NewReplacer(ReplacerPolicy policy, size_t capacity);
+
 #endif
\ No newline at end of file
@@ -2,25 +2,46 @@
 #ifndef BUFFER_POOL_MANAGER
 #define BUFFER_POOL_MANAGER
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <mutex>
 #include <optional>
-#include <unordered_map>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "basetype.h"
+#include "buffer/page_table.h"
+#include "buffer/replacer.h"
+#include "buffer/scan_ring.h"
 #include "frame.h"
 
+using std::condition_variable;
 using std::equal_to;
+using std::function;
 using std::hash;
 using std::list;
 using std::mutex;
 using std::optional;
-using std::unordered_map;
+using std::string;
+using std::thread;
+using std::unique_lock;
 using std::vector;
 
-class IReplacer;
+class FrameArena;
 class ISpaceManager;
+class IAsyncSpaceManager;
+
+/**
+ * @brief 乐观读取函数, 参数为帧上的页面, 返回 false 表示页面内容不一致
+ *
+ * 页面可能正被写者改写, 读取函数不能修改页面, 所有偏移量和长度都要核对
+ * 不越过页面, 循环也要有上限. 读取的结果只在缓冲池核对版本号后才有效.
+ */
+using OptimisticReader = function<bool(const char*)>;
 
 class IBufferPool {
  public:
@@ -29,34 +50,623 @@ class IBufferPool {
   virtual bool FlushPage(PagePosition page_position) = 0;
   virtual void FlushAllPage() = 0;
   virtual ~IBufferPool() = default;
+
+  /**
+   * @brief 通过扫描环获取并固定页面
+   *
+   * 缺页时优先复用扫描环中的帧, 长扫描不淘汰缓冲池中的热点页面.
+   * 默认忽略扫描环.
+   *
+   * @param page_position 页面位置
+   * @param ring 扫描环, 为 nullptr 时与 FetchPage(page_position) 相同
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
+  virtual Frame* FetchPage(PagePosition page_position, ScanRing*) {
+    return this->FetchPage(page_position);
+  }
+
+  /**
+   * @brief 获取并固定新分配的页面, 不从磁盘读取
+   *
+   * 页面尚未写入表空间, 缺页时帧清零后直接返回, 由调用方初始化.
+   * 默认与 FetchPage 相同.
+   *
+   * @param page_position 页面位置
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
+  virtual Frame* NewPage(PagePosition page_position) {
+    return this->FetchPage(page_position);
+  }
+
+  /**
+   * @brief 将扫描环中的帧交还缓冲池, 由扫描环析构时调用
+   *
+   * @param ring 扫描环
+   */
+  virtual void ReleaseScanRing(ScanRing*) {}
+
+  /**
+   * @brief 解除固定调用方持有的帧
+   *
+   * 调用方持有帧的固定, 帧上的页面不会变化, 实现可以省去按页面位置
+   * 的查找. 默认按页面位置解除固定.
+   *
+   * @param frame 帧
+   */
+  virtual void UnPinPage(Frame* frame) {
+    this->UnPinPage(frame->page_position);
+  }
+
+  /**
+   * @brief 表空间中保证能同时固定的页面数量
+   *
+   * 任意这么多个页面可以同时固定, 超过后 FetchPage 可能因为没有可用的帧
+   * 返回 nullptr. 默认不限制.
+   *
+   * @param space 表空间编号
+   * @return size_t
+   */
+  virtual size_t MaxPinnedPages(space_t) { return SIZE_MAX; }
+
+  /**
+   * @brief 标记页面被修改, 调用方持有帧的排他锁
+   *
+   * @param frame 帧
+   */
+  virtual void MarkDirty(Frame* frame) { frame->is_dirty = true; }
+
+  /**
+   * @brief 乐观读取页面, 不固定页面也不持有帧的锁, 也不复制页面
+   *
+   * 读取前后核对帧的版本号, reader 直接读取帧上的页面, 版本号不变时
+   * reader 得到的结果才有效. 页面不在缓冲池中, reader 返回 false,
+   * 或多次重试都与写者冲突时返回 false, 调用方回退到固定页面读取.
+   *
+   * @param page_position 页面位置
+   * @param reader 读取函数, 可能被调用多次, 只有最后一次的结果有效
+   */
+  virtual bool ReadPageOptimistic(PagePosition, const OptimisticReader&) {
+    return false;
+  }
+
+  /**
+   * @brief 预读页面, 在后台将页面读入缓冲池但不固定
+   *
+   * 预读期间 FetchPage 等待读取完成, 不会重复读盘. 缓冲池没有空闲帧
+   * 或只能淘汰脏页时放弃预读. 默认不预读.
+   *
+   * @param page_position 页面位置
+   */
+  virtual void Prefetch(PagePosition) {}
+
+  /**
+   * @brief 通过扫描环预读页面, 默认忽略扫描环
+   *
+   * @param page_position 页面位置
+   * @param ring 扫描环
+   */
+  virtual void Prefetch(PagePosition page_position, ScanRing*) {
+    this->Prefetch(page_position);
+  }
+
+  /**
+   * @brief 批量预读页面
+   *
+   * @param page_positions 页面位置
+   */
+  virtual void Prefetch(const vector<PagePosition>& page_positions) {
+    for (auto& page_position : page_positions) {
+      this->Prefetch(page_position);
+    }
+  }
 };
 
 class LRUBufferPool : public IBufferPool {
  public:
-  LRUBufferPool(size_t capacity);
+  /**
+   * @brief 构造缓冲池
+   *
+   * @param capacity 缓冲帧数量
+   * @param space_manager 表空间管理, 默认使用 TableSpaceDiskManager;
+   * 传入异步表空间管理时, 批量刷盘会同时下发多个写请求
+   * @param policy 页面替换策略
+   * @param max_capacity 在线扩容的最大帧数量, 默认等于 capacity
+   * @param page_size 帧大小, 只缓存页面大小与之相同的表空间
+   */
+  LRUBufferPool(size_t capacity, ISpaceManager* space_manager = nullptr,
+                ReplacerPolicy policy = ReplacerPolicy::kLRU,
+                size_t max_capacity = 0, size_t page_size = PAGE_SIZE);
   LRUBufferPool(const LRUBufferPool& other) = delete;
   LRUBufferPool(const LRUBufferPool&& other) = delete;
   virtual ~LRUBufferPool();
 
  public:
+  /**
+   * @brief 获取并固定页面
+   *
+   * 命中时无锁查找页表并增加帧的引用计数, 核对帧上的页面位置后返回;
+   * 缺页或帧正在被换入新页面时加缓冲池锁处理.
+   *
+   * @param page_position 页面位置
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
   virtual Frame* FetchPage(PagePosition page_position) override;
 
+  /**
+   * @brief 通过扫描环获取并固定页面
+   *
+   * 缺页时复用扫描环当前槽位上的帧; 该帧被固定、被修改或被其他线程
+   * 访问过时改为淘汰替换器中的帧, 换下的帧交还替换器.
+   *
+   * @param page_position 页面位置
+   * @param ring 扫描环
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
+  virtual Frame* FetchPage(PagePosition page_position,
+                           ScanRing* ring) override;
+
+  /**
+   * @brief 获取并固定新分配的页面, 缺页时帧清零, 不读盘
+   *
+   * @param page_position 页面位置
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
+  virtual Frame* NewPage(PagePosition page_position) override;
+
+  /**
+   * @brief 将扫描环中的帧交还缓冲池
+   *
+   * 只被扫描访问过的干净页面解除映射后放回空闲列表, 其余帧交还替换器
+   *
+   * @param ring 扫描环
+   */
+  virtual void ReleaseScanRing(ScanRing* ring) override;
+
   virtual void UnPinPage(PagePosition page_position) override;
+
+  /**
+   * @brief 解除固定, 引用计数不降为0时不加锁
+   *
+   * @param frame 帧
+   */
+  virtual void UnPinPage(Frame* frame) override;
   virtual bool FlushPage(PagePosition page_position) override;
   virtual void FlushAllPage();
+  virtual void MarkDirty(Frame* frame) override;
+
+  /**
+   * @brief 页面大小与帧大小相同的表空间为当前容量, 其余为0
+   *
+   * @param space 表空间编号
+   * @return size_t
+   */
+  virtual size_t MaxPinnedPages(space_t space) override;
+  virtual bool ReadPageOptimistic(PagePosition page_position,
+                                  const OptimisticReader& reader) override;
+  virtual void Prefetch(PagePosition page_position) override;
+  virtual void Prefetch(PagePosition page_position, ScanRing* ring) override;
+  virtual void Prefetch(const vector<PagePosition>& page_positions) override;
+
+  /**
+   * @brief 开启后台刷脏线程
+   *
+   * 脏页比例达到高水位时, 后台线程写回未被固定的脏页, 降到低水位后停止,
+   * 使 FetchPage 选中的淘汰帧基本都是干净的, 缺页时不必同步写回.
+   * 只对通过 MarkDirty 标记的脏页生效.
+   *
+   * @param high_watermark 高水位, 脏页占缓冲帧的比例
+   * @param low_watermark 低水位
+   */
+  void EnablePageCleaner(double high_watermark = DEFAULT_HIGH_WATERMARK,
+                         double low_watermark = DEFAULT_LOW_WATERMARK);
+
+  /**
+   * @brief 在线调整缓冲帧数量
+   *
+   * 扩容时新帧直接加入空闲列表, 不超过构造时的最大容量. 缩容时超出的帧
+   * 不再参与替换, 从最后一帧开始逐个等待解除固定后写回脏页并删除映射,
+   * 最后归还缓冲区内存; 期间缓冲池锁会周期性释放, 不阻塞并发的 FetchPage.
+   * 帧在 RESIZE_WAIT_TIMEOUT 内一直被固定(如索引常驻的页面)时停止缩容,
+   * 容量停在该帧之后.
+   *
+   * @param new_capacity 新的帧数量
+   * @return size_t 调整后的帧数量
+   */
+  size_t Resize(size_t new_capacity);
+
+  size_t capacity();
+
+  size_t page_size() const;
+
+  /**
+   * @brief 将缓冲池中的页面位置按热度保存到预热文件
+   *
+   * 被固定的页面在前, 其余按替换器的顺序排列, 不支持导出顺序的替换器
+   * 按页面映射的顺序补齐. 先写入临时文件再重命名, 保存失败不影响
+   * 已有的预热文件.
+   *
+   * @param path 预热文件路径
+   * @return true 成功
+   * @return false 失败
+   */
+  bool SaveWarmupFile(const string& path);
+
+  /**
+   * @brief 从预热文件将页面读回缓冲池
+   *
+   * 取最热的 capacity 个页面按地址排序, 地址连续的页面合并为一次
+   * 向量化读, 每次最多 MAX_READV_PAGES 页. 读取期间页面处于 kLoading
+   * 状态, 并发的 FetchPage 等待读取完成. 只使用空闲帧, 空闲帧用完后
+   * 停止, 不淘汰已经被访问的页面.
+   *
+   * @param path 预热文件路径
+   * @return size_t 读入的页面数量
+   */
+  size_t LoadWarmupFile(const string& path);
+
+  /**
+   * @brief 开启缓冲池预热
+   *
+   * 后台线程从预热文件读回页面, 同时缓冲池正常提供服务; 之后按间隔
+   * 周期性保存, 缓冲池正常析构时再保存一次.
+   *
+   * @param path 预热文件路径
+   * @param save_interval 保存间隔, 为0时只在析构时保存
+   */
+  void EnableWarmup(const string& path, std::chrono::seconds save_interval =
+                                            std::chrono::seconds(0));
+
+ public:
+  static constexpr double DEFAULT_HIGH_WATERMARK = 0.5;
+  static constexpr double DEFAULT_LOW_WATERMARK = 0.2;
+  static const size_t CLEANER_BATCH_SIZE = 32;
+  static const size_t MAX_WRITEV_PAGES = 64;
+  static const size_t MAX_READV_PAGES = 64;
+  static const size_t RESIZE_BATCH_SIZE = 64;
+  static constexpr std::chrono::milliseconds RESIZE_WAIT_TIMEOUT{100};
+  // 帧引用计数中的认领标记
+  static const uint64_t CLAIMED = 1ULL << 63;
+  static const size_t OPTIMISTIC_RETRIES = 8;
+  static constexpr std::chrono::milliseconds CLEANER_INTERVAL{100};
 
  private:
-  optional<frame_id_t> GetFreeFrame();
-  Frame* NewEmptyFrame(frame_id_t frame_id);
+  /**
+   * @brief 认领一个空闲帧或淘汰帧, 调用方持有缓冲池锁
+   *
+   * 认领的帧引用计数为 CLAIMED, 无锁命中的线程看到认领标记后放弃;
+   * 替换器中被无锁命中固定的帧认领失败, 从替换器移除, 解除固定时重新加入.
+   *
+   * @param evict 空闲帧用完后是否淘汰页面
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
+  Frame* ClaimFreeFrame(bool evict = true);
+
+  /**
+   * @brief 获取并固定页面
+   *
+   * @param page_position 页面位置
+   * @param ring 扫描环, 可以为 nullptr
+   * @param load 缺页时是否从磁盘读取, 否则帧清零
+   * @return Frame* 没有可用的帧时为 nullptr
+   */
+  Frame* PinPage(const PagePosition& page_position, ScanRing* ring, bool load);
+
+  /**
+   * @brief 表空间的页面大小是否与帧大小一致
+   *
+   * @param page_position 页面位置
+   * @return true
+   * @return false
+   */
+  bool AcceptsPage(const PagePosition& page_position) const;
+
+  /**
+   * @brief 认领引用计数为0的帧
+   *
+   * @param frame 帧
+   * @return true 成功
+   * @return false 帧被固定
+   */
+  static bool Claim(Frame* frame);
+
+  /**
+   * @brief 不加锁固定已在缓冲池中的页面, 页面正在加载时等待加载完成
+   *
+   * @param page_position 页面位置
+   * @param reference 是否记录访问, 扫描的访问不影响页面的热度
+   * @return Frame* 页面不在缓冲池, 帧正在被换入新页面或加载失败时为 nullptr
+   */
+  Frame* PinResident(const PagePosition& page_position, bool reference);
+
+  /**
+   * @brief 撤销无锁查找时对错误帧增加的引用计数
+   *
+   * @param frame 帧
+   */
+  void ReleaseStalePin(Frame* frame);
+
+  /**
+   * @brief 删除帧上页面的映射并清除页面位置, 调用方持有缓冲池锁且已认领帧
+   *
+   * @param frame 帧
+   */
+  void DetachFrame(Frame* frame);
+
+  void InitFrame(frame_id_t frame_id);
+
+  /**
+   * @brief 按当前容量计算刷脏水位, 调用方持有缓冲池锁
+   *
+   */
+  void UpdateWatermarks();
+
+  /**
+   * @brief 帧在当前容量内, 缩容中退出的帧不再回到空闲列表和替换器
+   *
+   * @param frame 帧
+   */
+  bool InCapacity(const Frame* frame) const;
+  Frame* frame(frame_id_t frame_id) const;
+
+  /**
+   * @brief 在缓冲池锁之外写回帧, 写回期间帧处于 kWritingBack 状态
+   *
+   * 用于淘汰脏页, 此时帧上没有页面守卫. 调用前持有缓冲池锁,
+   * 且帧已被调用方固定; 返回时重新持有缓冲池锁
+   *
+   * @param lock 缓冲池锁
+   * @param frame 帧
+   * @return false 写回失败, 页面仍是脏页, 不能淘汰
+   */
+  bool WriteBack(unique_lock<mutex>& lock, Frame* frame);
+
+  /**
+   * @brief 持有帧的共享锁写回脏页, 不持有缓冲池锁, 帧已被调用方固定
+   *
+   * 共享锁保证写回期间没有写守卫修改页面, 读守卫不受影响
+   *
+   * @param frame 帧
+   * @return false 写回失败, 页面仍是脏页
+   */
+  bool WriteLatched(Frame* frame);
+
+  /**
+   * @brief 写回失败或不完整时记录错误, 并将页面重新标记为脏页
+   *
+   * @param frame 帧
+   * @param done 实际写入的字节数
+   */
+  void WriteFailed(Frame* frame, size_t done);
+
+  /**
+   * @brief 批量写回已固定的脏页, 不持有缓冲池锁
+   *
+   * 页面按表空间和页地址排序后写回, 地址连续的页面合并为一次
+   * 向量化写, 每次最多 MAX_WRITEV_PAGES 页
+   *
+   * @param frames 帧, 会被重新排序
+   * @return false 有页面写回失败, 这些页面已重新标记为脏页
+   */
+  bool WriteFrames(vector<Frame*>& frames);
+
+  /**
+   * @brief 解除固定, 调用方持有缓冲池锁
+   *
+   * 引用计数降为0时将帧还给替换器, 并记录固定期间的命中
+   *
+   * @param frame 帧
+   */
+  void UnPinFrame(Frame* frame);
+
+  /**
+   * @brief 设置帧状态并唤醒等待该帧的线程
+   *
+   * @param frame 帧
+   * @param state 状态
+   */
+  static void SetFrameState(Frame* frame, FrameState state);
+
+  /**
+   * @brief 等待帧上的I/O完成
+   *
+   * @param frame 帧
+   */
+  static void WaitFrameReady(Frame* frame);
+
+  /**
+   * @brief 后台刷脏线程
+   *
+   */
+  void CleanPages();
+
+  /**
+   * @brief 从脏页列表中取出一批未被固定的脏页并固定, 调用方持有缓冲池锁
+   *
+   * 已经被写回的帧从列表中移除, 被固定的帧留在列表中
+   *
+   * @return vector<Frame*>
+   */
+  vector<Frame*> PickDirtyFrames();
+
+  /**
+   * @brief 预热线程, 读回页面后周期性保存预热文件
+   *
+   */
+  void WarmPages();
+
+  /**
+   * @brief 读入一批地址连续的预热页面, 不持有缓冲池锁
+   *
+   * 已在缓冲池中的页面跳过, 其余页面分配空闲帧后按连续区间向量化读取
+   *
+   * @param page_positions 地址连续的页面位置
+   * @param loaded 累加读入的页面数量
+   * @return true 继续预热
+   * @return false 空闲帧已用完或缓冲池正在析构
+   */
+  bool WarmRun(const vector<PagePosition>& page_positions, size_t& loaded);
+
+  /**
+   * @brief 停止后台刷脏、预读和预热线程, 等待在途的预读完成
+   *
+   */
+  void StopBackgroundThreads();
+
+  /**
+   * @brief 帧装入新页面, 调用方持有缓冲池锁
+   *
+   * 建立页面映射, 解除认领并固定帧, 帧处于 kLoading 状态, 由调用方在锁外读盘
+   *
+   * @param frame 已认领的干净帧
+   * @param page_position 页面位置
+   */
+  void AssignFrame(Frame* frame, const PagePosition& page_position);
+
+  /**
+   * @brief 帧上的页面读入完成, 版本号恢复为偶数并唤醒等待加载的线程
+   *
+   * @param frame 帧
+   */
+  void CompleteLoad(Frame* frame);
+
+  /**
+   * @brief 读取的字节数是否有效: 读满整页, 或者读到了文件尾
+   *
+   * 文件尾之后的部分由表空间管理填充0, 视为未写入的空页
+   *
+   * @param page_position 页面位置
+   * @param space_size 读取之前表空间的长度
+   * @param done 实际读取的字节数
+   */
+  bool ReadSucceeded(const PagePosition& page_position, size_t space_size,
+                     size_t done) const;
+
+  /**
+   * @brief 帧上的页面读取失败, 调用方持有缓冲池锁和帧的固定
+   *
+   * 删除页面映射, 帧放回空闲列表, 唤醒等待加载的线程; 它们核对页面位置
+   * 后放弃. 调用方随后解除自己的固定. 失败的页面不会以全0的内容留在
+   * 缓冲池中, 之后也不会被写回覆盖磁盘上的数据.
+   *
+   * @param frame 帧
+   * @param done 实际读取的字节数
+   */
+  void FailLoad(Frame* frame, size_t done);
+
+  /**
+   * @brief 等待固定的帧加载完成
+   *
+   * @param frame 帧
+   * @param page_position 页面位置
+   * @return Frame* 加载失败时解除固定并返回 nullptr
+   */
+  Frame* WaitLoaded(Frame* frame, const PagePosition& page_position);
+
+  /**
+   * @brief 为预读页面分配帧, 调用方持有缓冲池锁
+   *
+   * @param page_position 页面位置
+   * @param ring 扫描环, 不为 nullptr 时优先复用环中的帧
+   * @return Frame* 已装入页面的帧, 页面已在缓冲池或没有干净的帧时为 nullptr
+   */
+  Frame* ReservePrefetchFrame(const PagePosition& page_position,
+                              ScanRing* ring = nullptr);
+
+  /**
+   * @brief 扫描环在本缓冲池中的槽位, 首次使用时分配, 调用方持有缓冲池锁
+   *
+   * @param ring 扫描环
+   * @return ScanRing::Ring& 槽位
+   */
+  ScanRing::Ring& RingOf(ScanRing* ring);
+
+  /**
+   * @brief 认领扫描环当前槽位上的帧, 调用方持有缓冲池锁
+   *
+   * @param ring 扫描环
+   * @return Frame* 已认领的干净帧, 槽位为空或帧不能复用时为 nullptr
+   */
+  Frame* ClaimRingFrame(ScanRing* ring);
+
+  /**
+   * @brief 将装入页面的帧放入扫描环当前槽位, 换下的帧离开扫描环,
+   * 调用方持有缓冲池锁
+   *
+   * @param ring 扫描环
+   * @param frame 帧
+   */
+  void AddToRing(ScanRing* ring, Frame* frame);
+
+  /**
+   * @brief 帧离开扫描环, 未被固定时交还替换器, 调用方持有缓冲池锁
+   *
+   * @param ring 扫描环
+   * @param frame 帧
+   */
+  void LeaveRing(ScanRing* ring, Frame* frame);
+
+  /**
+   * @brief 下发预读请求, 不持有缓冲池锁
+   *
+   * @param frames 已分配的帧
+   */
+  void IssuePrefetch(const vector<Frame*>& frames);
+
+  /**
+   * @brief 预读完成, 帧状态恢复为 kReady 并解除预读时的固定
+   *
+   * @param frame 帧
+   * @param page_position 预读的页面位置
+   * @param space_size 提交读取之前表空间的长度
+   * @param done 实际读取的字节数
+   */
+  void CompletePrefetch(Frame* frame, const PagePosition& page_position,
+                        size_t space_size, size_t done);
+
+  /**
+   * @brief 同步表空间管理下执行预读的后台线程
+   *
+   */
+  void PrefetchPages();
 
  private:
   size_t capacity_;
+  // 帧大小, 等于缓存的表空间的页面大小
+  size_t page_size_;
   IReplacer* replacer;
   ISpaceManager* space_manager_;
+  IAsyncSpaceManager* async_space_manager_;
   mutex pool_lock_;
-  list<frame_id_t> frees_;
-  vector<Frame*> frames_;
-  unordered_map<PagePosition, frame_id_t> frame_ids_;
+  // 空闲帧栈, 栈顶的帧优先使用
+  vector<frame_id_t> frees_;
+  FrameArena* arena_;
+  PageTable* page_table_;
+
+  // 脏页列表, 按变脏的先后顺序排列, 写回后延迟移除
+  list<frame_id_t> dirty_frames_;
+  vector<bool> dirty_listed_;
+
+  thread cleaner_;
+  condition_variable cleaner_cv_;
+  bool stopping_;
+
+  // 同步表空间管理下的预读队列
+  thread prefetcher_;
+  condition_variable prefetch_cv_;
+  list<Frame*> prefetch_queue_;
+  double high_watermark_ratio_;
+  double low_watermark_ratio_;
+  size_t high_watermark_;
+  size_t low_watermark_;
+
+  // 串行化并发的 Resize
+  mutex resize_lock_;
+
+  // 预热文件, 为空时不保存
+  string warmup_file_;
+  std::chrono::seconds warmup_interval_;
+  thread warmer_;
+  condition_variable warmup_cv_;
 };
 
 #endif
\ No newline at end of file
@@ -13,7 +13,7 @@ struct FrameConstructor {
 
 template <typename T>
 struct FrameDeconstructor {
-  static void Deconstruct(T *data) { return; }
+  static void Deconstruct(T *) { return; }
 };
 
 #endif
\ No newline at end of file
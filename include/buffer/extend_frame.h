@@ -35,84 +35,99 @@ class LocalAutoReleaseFrameData {
   IBufferPool *pool_;
 };
 
+/**
+ * @brief 共享的页面对象
+ *
+ * 页面固定在缓冲池中, 直到最后一个持有者释放. 所有持有者共享同一个
+ * 带引用计数的状态, 拷贝只增加原子计数, 移动不修改计数, 可以在线程
+ * 之间和容器中传递. 状态在构造时从堆上分配一次, 之后的拷贝不再分配.
+ * 缓冲池没有可用的帧时句柄为空, valid() 返回 false.
+ */
 template <typename T>
-class SharedFrameData : public Reference {
+class SharedFrameData {
  public:
-  SharedFrameData() {
-    pool_ = nullptr;
-    frame_ = nullptr;
-    data_ = nullptr;
-  };
+  SharedFrameData() : state_(nullptr) {}
 
   template <typename... Args>
-  SharedFrameData(IBufferPool *pool, PagePosition position, Args &&... args) {
-    pool_ = pool;
-    position_ = position;
-    frame_ = pool_->FetchPage(position_);
-    data_ = FrameConstructor<T>::Construct(frame_, std::forward<Args>(args)...);
+  SharedFrameData(IBufferPool *pool, PagePosition position, Args &&... args)
+      : state_(nullptr) {
+    Frame *frame = pool->FetchPage(position);
+    if (frame == nullptr) {
+      spdlog::error("{}: position={}, no free frame", __func__, position);
+      return;
+    }
+    state_ = new State();
+    state_->pool = pool;
+    state_->position = position;
+    state_->frame = frame;
+    state_->data =
+        FrameConstructor<T>::Construct(frame, std::forward<Args>(args)...);
   }
 
-  SharedFrameData(const SharedFrameData<T> &other) { this->Copy(other); }
-
-  SharedFrameData(const SharedFrameData<T> &&other) { this->Move(move(other)); }
-
-  SharedFrameData<T> &operator=(const SharedFrameData<T> &other) {
-    this->DecrementReference();
-    if (this->reference_count() == 0) {
-      this->Deconstruct();
+  SharedFrameData(const SharedFrameData<T> &other) : state_(other.state_) {
+    if (state_ != nullptr) {
+      state_->IncrementReference();
     }
-    return this->Copy(other);
   }
 
-  SharedFrameData<T> &operator=(SharedFrameData<T> &&other) {
-    this->DecrementReference();
-    if (this->reference_count() == 0) {
-      this->Deconstruct();
-    }
-    return this->Move(move(other));
+  SharedFrameData(SharedFrameData<T> &&other) noexcept
+      : state_(other.state_) {
+    other.state_ = nullptr;
   }
 
-  void Deconstruct() {
-    if (pool_ != nullptr) {
-      pool_->UnPinPage(position_);
-      FrameDeconstructor<T>::Deconstruct(data_);
+  SharedFrameData<T> &operator=(const SharedFrameData<T> &other) {
+    if (state_ != other.state_) {
+      if (other.state_ != nullptr) {
+        other.state_->IncrementReference();
+      }
+      this->Release();
+      state_ = other.state_;
     }
+    return *this;
   }
 
-  ~SharedFrameData() {
-    this->DecrementReference();
-    if (this->reference_count() == 0) {
-      this->Deconstruct();
+  SharedFrameData<T> &operator=(SharedFrameData<T> &&other) noexcept {
+    if (this != &other) {
+      this->Release();
+      state_ = other.state_;
+      other.state_ = nullptr;
     }
+    return *this;
   }
 
+  ~SharedFrameData() { this->Release(); }
+
  public:
-  const T *operator->() const { return data_; }
-  // T *operator->() const { return data_; }
-  Frame *frame() { return frame_; }
-  T *data() { return data_; }
+  const T *operator->() const { return state_->data; }
+  T *operator->() { return state_->data; }
+  bool valid() const { return state_ != nullptr; }
+  Frame *frame() { return state_ == nullptr ? nullptr : state_->frame; }
+  T *data() { return state_ == nullptr ? nullptr : state_->data; }
+
+  size_t reference_count() const {
+    return state_ == nullptr ? 0 : state_->reference_count();
+  }
 
  private:
-  SharedFrameData<T> &Copy(const SharedFrameData<T> &other) {
-    this->IncrementReference();
-    this->reference_count_ = other.reference_count_;
-    this->pool_ = other.pool_;
-    this->position_ = other.position_;
-    this->data_ = other.data_;
-    return *this;
-  }
+  struct State : public Reference {
+    IBufferPool *pool;
+    Frame *frame;
+    T *data;
+    PagePosition position;
+  };
 
-  SharedFrameData<T> &Move(SharedFrameData<T> &&other) {
-    this->reference_count_ = move(other.reference_count_);
-    this->pool_ = move(other.pool_);
-    this->position_ = move(other.position_);
-    this->data_ = move(other.data_);
-    return *this;
+  /**
+   * @brief 释放持有的引用, 最后一个持有者析构对象并解除页面固定
+   */
+  void Release() {
+    if (state_ != nullptr && state_->DecrementReference() == 0) {
+      FrameDeconstructor<T>::Deconstruct(state_->data);
+      state_->pool->UnPinPage(state_->frame);
+      delete state_;
+    }
+    state_ = nullptr;
   }
 
  private:
-  IBufferPool *pool_;
-  Frame *frame_;
-  T *data_;
-  PagePosition position_;
-};
\ No newline at end of file
+  State *state_;
+};
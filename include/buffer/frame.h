@@ -3,12 +3,23 @@
 
 #include <fmt/ostream.h>
 
+#include <atomic>
 #include <iostream>
+#include <shared_mutex>
 #include <type_traits>
 
+using std::atomic;
 using std::hash;
 using std::ostream;
+using std::shared_mutex;
 
+class ScanRing;
+
+/**
+ * @brief 页面位置, 由表空间编号和页地址组成
+ *
+ * 可平凡复制的16字节键, 哈希和比较不涉及字符串
+ */
 struct PagePosition {
   space_t space;
   address_t page_address;
@@ -18,15 +29,38 @@ struct PagePosition {
   }
 };
 
+static_assert(std::is_trivially_copyable_v<PagePosition>);
+static_assert(sizeof(PagePosition) == 16);
+
+/**
+ * @brief 帧的I/O状态
+ *
+ * 磁盘读写在缓冲池锁之外进行, 读写期间帧处于 kLoading 或 kWritingBack,
+ * 访问该帧的线程在状态回到 kReady 之前等待.
+ */
+enum class FrameState : uint8_t { kReady = 0, kLoading, kWritingBack };
+
 struct Frame {
   PagePosition page_position;
   frame_id_t id;
   space_t space;
   address_t page_address;
-  uint64_t pin_count;
+  // 缓冲池命中时不加锁增加, 最高位表示帧被缓冲池认领, 正在换入新页面
+  atomic<uint64_t> pin_count;
   uint64_t frame_size;
   char* buffer;
-  bool is_dirty;
+  // 写守卫在持有排他锁时标记, 写回线程在缓冲池锁下读取
+  atomic<bool> is_dirty;
+  // 无锁命中时置位, 解除固定时向替换器记录访问
+  atomic<bool> referenced;
+  atomic<FrameState> state;
+  // 页面版本号, 修改页面内容或换入新页面期间为奇数, 完成后为偶数;
+  // 乐观读前后版本号不变时读到的页面完整
+  atomic<uint64_t> version;
+  // 帧所属的扫描环, 不属于扫描环时为 nullptr, 在缓冲池锁下读写
+  ScanRing* ring;
+  // 页面读写锁, 读页面持有共享锁, 修改页面持有排他锁
+  shared_mutex latch;
 };
 
 namespace std {
@@ -41,15 +75,24 @@ struct hash<Frame> {
 namespace std {
 template <>
 struct hash<PagePosition> {
-  size_t operator()(const PagePosition& page_position) const {
-    return hash<space_t>()(page_position.space) << 32 |
-           hash<address_t>()(page_position.page_address);
+  size_t operator()(const PagePosition& page_position) const noexcept {
+    // 页地址按页大小对齐, 低位全为0, 混合后每一位都参与分桶
+    uint64_t h = static_cast<uint64_t>(page_position.page_address) ^
+                 static_cast<uint64_t>(page_position.space) *
+                     0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
   }
 };
 
 template <>
 struct equal_to<PagePosition> {
-  bool operator()(const PagePosition& lhs, const PagePosition& rhs) const {
+  bool operator()(const PagePosition& lhs,
+                  const PagePosition& rhs) const noexcept {
     return lhs.space == rhs.space && lhs.page_address == rhs.page_address;
   }
 };
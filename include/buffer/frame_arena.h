@@ -0,0 +1,94 @@
+#pragma once
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include "basetype.h"
+#include "buffer/frame.h"
+
+/**
+ * @brief 缓冲帧内存区
+ *
+ * 所有帧的缓冲区从一块连续的匿名映射中按帧大小切分, 优先使用
+ * MAP_HUGETLB 大页, 不可用时按大页边界对齐并通过 MADV_HUGEPAGE
+ * 申请透明大页, 减少大缓冲池的TLB缺失. 映射的物理内存在首次访问时
+ * 才分配, 大缓冲池也可以快速启动.
+ *
+ * 帧的元数据存放在按 frame_id 索引的连续数组中. 构造时按最大容量预留
+ * 地址空间, 扩容时只需构造新的帧, 已有帧的地址保持不变.
+ */
+class FrameArena {
+ public:
+  /**
+   * @brief 构造内存区
+   *
+   * @param capacity 初始帧数量
+   * @param max_capacity 最大帧数量, 小于 capacity 时等于 capacity
+   * @param frame_size 帧大小
+   */
+  FrameArena(size_t capacity, size_t max_capacity = 0,
+             size_t frame_size = PAGE_SIZE);
+  FrameArena(const FrameArena &other) = delete;
+  FrameArena(const FrameArena &&other) = delete;
+  ~FrameArena();
+
+ public:
+  Frame *frame(frame_id_t frame_id) const { return &frames_[frame_id]; }
+  char *buffer(frame_id_t frame_id) const {
+    return base_ + frame_id * frame_size_;
+  }
+
+  /**
+   * @brief 已构造的帧数量
+   *
+   * @return size_t
+   */
+  size_t capacity() const { return capacity_; }
+  size_t max_capacity() const { return max_capacity_; }
+
+  /**
+   * @brief 构造帧直到数量达到 capacity, 不超过最大容量
+   *
+   * @param capacity 帧数量
+   * @return size_t 扩容后的帧数量
+   */
+  size_t Grow(size_t capacity);
+
+  /**
+   * @brief 归还帧缓冲区占用的物理内存, 帧本身保留, 再次使用时内容为0
+   *
+   * @param begin 起始帧
+   * @param end 结束帧(不包含)
+   */
+  void Release(frame_id_t begin, frame_id_t end);
+
+  /**
+   * @brief 缓冲区是否申请了大页(MAP_HUGETLB 或透明大页)
+   *
+   * @return true
+   * @return false
+   */
+  bool huge_pages() const { return huge_pages_; }
+
+ public:
+  static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+ private:
+  /**
+   * @brief 映射缓冲区
+   *
+   * @param size 大小, 按大页大小对齐
+   */
+  void Map(size_t size);
+
+ private:
+  size_t capacity_;
+  size_t max_capacity_;
+  size_t frame_size_;
+  size_t mapped_size_;
+  char *base_;
+  Frame *frames_;
+  size_t frames_size_;
+  bool huge_pages_;
+};
+
+#endif
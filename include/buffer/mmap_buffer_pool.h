@@ -0,0 +1,60 @@
+#pragma once
+#ifndef MMAP_BUFFER_POOL_H
+#define MMAP_BUFFER_POOL_H
+
+#include <mutex>
+#include <unordered_map>
+
+#include "basetype.h"
+#include "buffer/buffer_pool.h"
+#include "buffer/frame.h"
+
+using std::mutex;
+using std::unordered_map;
+
+class MMapSpaceManager;
+
+/**
+ * @brief 基于内存映射的只读缓冲池
+ *
+ * 帧的缓冲区直接指向表空间映射区域中的页面, 获取页面不需要拷贝数据,
+ * 页面由操作系统按需换入换出. 对页面的修改不会写回文件.
+ * 帧只记录映射地址, 最后一次解除固定时释放.
+ *
+ * 只供直接按页面位置读取快照的调用方独立使用, 不能作为 BPlusTreeIndex
+ * 的缓冲池: 索引通过 TableSpaceDiskManager 读写元数据并分配新页面,
+ * 这些修改不会反映到映射中.
+ */
+class MMapBufferPool : public IBufferPool {
+ public:
+  MMapBufferPool();
+  MMapBufferPool(const MMapBufferPool& other) = delete;
+  MMapBufferPool(const MMapBufferPool&& other) = delete;
+  virtual ~MMapBufferPool();
+
+ public:
+  virtual Frame* FetchPage(PagePosition page_position) override;
+  /**
+   * @brief 解除固定页面, 固定计数降为0时释放帧
+   *
+   * @param page_position 页面位置
+   */
+  virtual void UnPinPage(PagePosition page_position) override;
+
+  /**
+   * @brief 只读缓冲池不写回页面
+   *
+   * @return true 页面在缓冲池中
+   * @return false
+   */
+  virtual bool FlushPage(PagePosition page_position) override;
+  virtual void FlushAllPage() override;
+
+ private:
+  MMapSpaceManager* space_manager_;
+  mutex pool_lock_;
+  unordered_map<PagePosition, Frame*> frames_;
+  frame_id_t next_frame_id_;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef PAGE_GUARD_H
+#define PAGE_GUARD_H
+
+#include <utility>
+
+#include "buffer/buffer_pool.h"
+#include "buffer/frame.h"
+
+/**
+ * @brief 页面读守卫
+ *
+ * 构造时从缓冲池固定页面并持有帧的共享锁, 析构时释放共享锁并解除固定.
+ * 长扫描可以传入扫描环. 只能移动, 不能拷贝.
+ */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+  ReadPageGuard(IBufferPool *pool, PagePosition page_position,
+                ScanRing *ring = nullptr)
+      : pool_(pool), frame_(pool->FetchPage(page_position, ring)) {
+    if (frame_ != nullptr) {
+      frame_->latch.lock_shared();
+    }
+  }
+  ReadPageGuard(const ReadPageGuard &other) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &other) = delete;
+  ReadPageGuard(ReadPageGuard &&other) noexcept
+      : pool_(std::exchange(other.pool_, nullptr)),
+        frame_(std::exchange(other.frame_, nullptr)) {}
+  ReadPageGuard &operator=(ReadPageGuard &&other) noexcept {
+    if (this != &other) {
+      Release();
+      pool_ = std::exchange(other.pool_, nullptr);
+      frame_ = std::exchange(other.frame_, nullptr);
+    }
+    return *this;
+  }
+  ~ReadPageGuard() { Release(); }
+
+ public:
+  /**
+   * @brief 提前释放页面
+   *
+   */
+  void Release() {
+    if (frame_ == nullptr) {
+      return;
+    }
+    frame_->latch.unlock_shared();
+    pool_->UnPinPage(frame_);
+    frame_ = nullptr;
+  }
+
+  bool valid() const { return frame_ != nullptr; }
+  Frame *frame() const { return frame_; }
+  /**
+   * @brief 页面数据, 缓冲池没有可用的帧时为 nullptr
+   */
+  const char *data() const {
+    return frame_ == nullptr ? nullptr : frame_->buffer;
+  }
+
+ private:
+  IBufferPool *pool_ = nullptr;
+  Frame *frame_ = nullptr;
+};
+
+/**
+ * @brief 页面写守卫
+ *
+ * 构造时从缓冲池固定页面并持有帧的排他锁, 持有期间帧的版本号为奇数;
+ * 新分配的页面不从磁盘读取.
+ * 析构时将页面标记为脏页, 再释放排他锁并解除固定. 只能移动, 不能拷贝.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+  WritePageGuard(IBufferPool *pool, PagePosition page_position,
+                 bool is_new = false)
+      : pool_(pool),
+        frame_(is_new ? pool->NewPage(page_position)
+                      : pool->FetchPage(page_position)) {
+    if (frame_ != nullptr) {
+      frame_->latch.lock();
+      // 版本号变为奇数, 乐观读者放弃此期间读到的页面
+      frame_->version.fetch_add(1, std::memory_order_acq_rel);
+    }
+  }
+  WritePageGuard(const WritePageGuard &other) = delete;
+  WritePageGuard &operator=(const WritePageGuard &other) = delete;
+  WritePageGuard(WritePageGuard &&other) noexcept
+      : pool_(std::exchange(other.pool_, nullptr)),
+        frame_(std::exchange(other.frame_, nullptr)) {}
+  WritePageGuard &operator=(WritePageGuard &&other) noexcept {
+    if (this != &other) {
+      Release();
+      pool_ = std::exchange(other.pool_, nullptr);
+      frame_ = std::exchange(other.frame_, nullptr);
+    }
+    return *this;
+  }
+  ~WritePageGuard() { Release(); }
+
+ public:
+  /**
+   * @brief 提前释放页面
+   *
+   */
+  void Release() {
+    if (frame_ == nullptr) {
+      return;
+    }
+    // 在持有排他锁时标记脏页, 保证写回线程看到完整的修改
+    pool_->MarkDirty(frame_);
+    frame_->version.fetch_add(1, std::memory_order_release);
+    frame_->latch.unlock();
+    pool_->UnPinPage(frame_);
+    frame_ = nullptr;
+  }
+
+  bool valid() const { return frame_ != nullptr; }
+  Frame *frame() const { return frame_; }
+  /**
+   * @brief 页面数据, 缓冲池没有可用的帧时为 nullptr
+   */
+  char *data() const { return frame_ == nullptr ? nullptr : frame_->buffer; }
+
+ private:
+  IBufferPool *pool_ = nullptr;
+  Frame *frame_ = nullptr;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <atomic>
+
+#include "basetype.h"
+#include "buffer/frame.h"
+
+using std::atomic;
+
+/**
+ * @brief 缓冲池页表, 页面位置到帧的映射
+ *
+ * 固定大小的开放寻址哈希表, 线性探测, 槽数量为帧数量两倍以上的2的幂,
+ * 插入不分配内存. 删除时将后续槽向前移动, 不留下墓碑.
+ *
+ * 修改由调用方在缓冲池锁下串行执行; Find 不加锁, 与修改并发时可能
+ * 漏掉正在移动的映射, 也可能读到键和帧不一致的槽. 无锁查找的结果只是
+ * 候选, 调用方需要固定帧后核对帧上的页面位置, 查不到时再加锁查找.
+ */
+class PageTable {
+ public:
+  /**
+   * @brief 构造页表
+   *
+   * @param capacity 最多同时映射的页面数量
+   */
+  PageTable(size_t capacity);
+  PageTable(const PageTable &other) = delete;
+  PageTable(const PageTable &&other) = delete;
+  ~PageTable();
+
+ public:
+  /**
+   * @brief 查找页面所在的帧, 不加锁
+   *
+   * @param page_position 页面位置
+   * @return frame_id_t 不存在时为 INVALID_FRAME
+   */
+  frame_id_t Find(const PagePosition &page_position) const;
+
+  /**
+   * @brief 建立映射, 页面已存在时更新帧
+   *
+   * @param page_position 页面位置
+   * @param frame_id 帧
+   */
+  void Insert(const PagePosition &page_position, frame_id_t frame_id);
+
+  /**
+   * @brief 删除映射, 只删除指向 frame_id 的映射
+   *
+   * @param page_position 页面位置
+   * @param frame_id 帧
+   * @return true 删除成功
+   * @return false 页面不存在或映射到其他帧
+   */
+  bool Erase(const PagePosition &page_position, frame_id_t frame_id);
+
+  size_t size() const { return size_; }
+
+  /**
+   * @brief 遍历所有映射, 调用方持有缓冲池锁
+   *
+   * @param func 参数为页面位置和帧
+   */
+  template <typename Func>
+  void ForEach(Func &&func) const {
+    for (size_t i = 0; i <= mask_; i++) {
+      frame_id_t frame_id = slots_[i].frame_id.load(std::memory_order_relaxed);
+      if (frame_id != INVALID_FRAME) {
+        func(this->Key(i), frame_id);
+      }
+    }
+  }
+
+ public:
+  static constexpr frame_id_t INVALID_FRAME = -1;
+
+ private:
+  struct Slot {
+    atomic<address_t> page_address;
+    atomic<space_t> space;
+    atomic<frame_id_t> frame_id;
+  };
+
+  size_t Home(const PagePosition &page_position) const {
+    return std::hash<PagePosition>()(page_position) & mask_;
+  }
+
+  PagePosition Key(size_t slot) const {
+    return {slots_[slot].space.load(std::memory_order_relaxed),
+            slots_[slot].page_address.load(std::memory_order_relaxed)};
+  }
+
+  /**
+   * @brief 写入槽, 先写键再发布帧
+   *
+   */
+  void Store(size_t slot, const PagePosition &page_position,
+             frame_id_t frame_id);
+
+ private:
+  size_t mask_;
+  Slot *slots_;
+  size_t size_;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef SCAN_RING_H
+#define SCAN_RING_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "basetype.h"
+#include "buffer/frame.h"
+
+using std::unordered_map;
+using std::vector;
+
+class IBufferPool;
+
+/**
+ * @brief 扫描环, 长扫描私有的一小组缓冲帧
+ *
+ * 通过扫描环获取页面时, 缺页优先复用环中最早装入的帧, 顺序扫描的页面
+ * 只在环内轮换, 不会淘汰缓冲池中共享的热点页面. 环中的帧解除固定后
+ * 不交给替换器; 被其他线程访问过或被修改过的帧不再复用, 换出环后交还
+ * 替换器.
+ *
+ * 环的槽位按缓冲池(分片)分别分配, 每个缓冲池最多占用 size 个帧且不超过
+ * 其容量的 1/8. 扫描环不是线程安全的, 只能由一个扫描线程使用; 析构时将
+ * 环中的帧交还缓冲池.
+ */
+class ScanRing {
+ public:
+  /**
+   * @brief 构造扫描环
+   *
+   * @param pool 缓冲池
+   * @param size 每个缓冲池(分片)中环的最大帧数量
+   */
+  ScanRing(IBufferPool *pool, size_t size = DEFAULT_SIZE);
+  ScanRing(const ScanRing &other) = delete;
+  ScanRing &operator=(const ScanRing &other) = delete;
+  ~ScanRing();
+
+ public:
+  size_t size() const { return size_; }
+
+ public:
+  static const size_t DEFAULT_SIZE = 16;
+
+ private:
+  friend class LRUBufferPool;
+
+  struct Ring {
+    // 环中的帧, 未装入时为 nullptr
+    vector<Frame *> frames;
+    // 下一个复用的槽位
+    size_t next = 0;
+  };
+
+  IBufferPool *pool_;
+  size_t size_;
+  unordered_map<const IBufferPool *, Ring> rings_;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#pragma once
+#ifndef SHARDED_BUFFER_POOL_H
+#define SHARDED_BUFFER_POOL_H
+
+#include <vector>
+
+#include "basetype.h"
+#include "buffer/buffer_pool.h"
+#include "buffer/frame.h"
+
+using std::vector;
+
+class ISpaceManager;
+
+/**
+ * @brief 分片缓冲池
+ *
+ * 按页面位置的哈希将页面分配到多个相互独立的 LRUBufferPool 分片,
+ * 每个分片拥有自己的锁、空闲列表、页表和替换器, 不同分片上的
+ * FetchPage/UnPinPage 不会相互竞争.
+ *
+ * 每个分片的容量为总容量均分后向上取整, 同一分片上同时固定的页面数量
+ * 不能超过分片容量.
+ */
+class ShardedBufferPool : public IBufferPool {
+ public:
+  /**
+   * @brief 构造分片缓冲池
+   *
+   * @param capacity 总缓冲帧数量
+   * @param shards 分片数量, 为0时使用硬件线程数
+   * @param space_manager 表空间管理
+   * @param policy 每个分片的页面替换策略
+   * @param max_capacity 在线扩容的最大总帧数量, 默认等于 capacity
+   * @param page_size 帧大小
+   */
+  ShardedBufferPool(size_t capacity, size_t shards = 0,
+                    ISpaceManager* space_manager = nullptr,
+                    ReplacerPolicy policy = ReplacerPolicy::kLRU,
+                    size_t max_capacity = 0, size_t page_size = PAGE_SIZE);
+  ShardedBufferPool(const ShardedBufferPool& other) = delete;
+  ShardedBufferPool(const ShardedBufferPool&& other) = delete;
+  virtual ~ShardedBufferPool();
+
+ public:
+  virtual Frame* FetchPage(PagePosition page_position) override;
+  virtual Frame* FetchPage(PagePosition page_position,
+                           ScanRing* ring) override;
+  virtual Frame* NewPage(PagePosition page_position) override;
+  virtual void ReleaseScanRing(ScanRing* ring) override;
+  virtual void UnPinPage(PagePosition page_position) override;
+  virtual void UnPinPage(Frame* frame) override;
+  virtual bool FlushPage(PagePosition page_position) override;
+  virtual void FlushAllPage() override;
+  virtual void MarkDirty(Frame* frame) override;
+
+  /**
+   * @brief 页面可能集中在同一个分片, 为分片中的最小值
+   *
+   * @param space 表空间编号
+   * @return size_t
+   */
+  virtual size_t MaxPinnedPages(space_t space) override;
+  virtual bool ReadPageOptimistic(PagePosition page_position,
+                                  const OptimisticReader& reader) override;
+  virtual void Prefetch(PagePosition page_position) override;
+  virtual void Prefetch(PagePosition page_position, ScanRing* ring) override;
+  virtual void Prefetch(const vector<PagePosition>& page_positions) override;
+
+ public:
+  size_t shards() const;
+
+  /**
+   * @brief 每个分片开启后台刷脏线程
+   *
+   * @param high_watermark 高水位
+   * @param low_watermark 低水位
+   */
+  void EnablePageCleaner(
+      double high_watermark = LRUBufferPool::DEFAULT_HIGH_WATERMARK,
+      double low_watermark = LRUBufferPool::DEFAULT_LOW_WATERMARK);
+
+  /**
+   * @brief 在线调整总帧数量, 均分到每个分片
+   *
+   * @param new_capacity 新的总帧数量
+   * @return size_t 调整后的总帧数量
+   */
+  size_t Resize(size_t new_capacity);
+
+  /**
+   * @brief 每个分片开启缓冲池预热, n 个分片中的第 i 个使用预热文件 path.n.i
+   *
+   * 分片数量变化后页面所属的分片不同, 文件名中带有分片数量, 不会读入
+   * 旧的预热文件
+   *
+   * @param path 预热文件路径前缀
+   * @param save_interval 保存间隔
+   */
+  void EnableWarmup(const string& path, std::chrono::seconds save_interval =
+                                            std::chrono::seconds(0));
+
+ private:
+  /**
+   * @brief 页面所在的分片
+   *
+   * @param page_position 页面位置
+   * @return LRUBufferPool*
+   */
+  LRUBufferPool* Shard(const PagePosition& page_position);
+
+  /**
+   * @brief 页面所在分片的下标
+   *
+   * @param page_position 页面位置
+   * @return size_t
+   */
+  size_t ShardIndex(const PagePosition& page_position);
+
+ private:
+  vector<LRUBufferPool*> shards_;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef SIZE_CLASS_BUFFER_POOL_H
+#define SIZE_CLASS_BUFFER_POOL_H
+
+#include <map>
+#include <vector>
+
+#include "basetype.h"
+#include "buffer/buffer_pool.h"
+#include "buffer/frame.h"
+
+using std::map;
+using std::vector;
+
+class ISpaceManager;
+
+/**
+ * @brief 多页面大小的缓冲池
+ *
+ * 每种页面大小(尺寸级别)使用一个独立的分片缓冲池, 帧大小等于该级别的
+ * 页面大小. 按页面位置的操作根据表空间注册的页面大小选择尺寸级别,
+ * 按帧的操作根据帧大小选择. 小页面的点查索引和大页面的扫描索引可以
+ * 共用一个缓冲池, 各自的帧数量分别配置.
+ *
+ * 没有配置尺寸级别的表空间不能缓存, FetchPage 返回 nullptr.
+ */
+class SizeClassBufferPool : public IBufferPool {
+ public:
+  /**
+   * @brief 构造多页面大小的缓冲池
+   *
+   * @param capacities 页面大小到缓冲帧数量的映射, 页面大小不合法的项被忽略
+   * @param shards 每个尺寸级别的分片数量
+   * @param space_manager 表空间管理
+   * @param policy 页面替换策略
+   */
+  SizeClassBufferPool(const map<size_t, size_t>& capacities, size_t shards = 1,
+                      ISpaceManager* space_manager = nullptr,
+                      ReplacerPolicy policy = ReplacerPolicy::kLRU);
+  SizeClassBufferPool(const SizeClassBufferPool& other) = delete;
+  SizeClassBufferPool(const SizeClassBufferPool&& other) = delete;
+  virtual ~SizeClassBufferPool();
+
+ public:
+  virtual Frame* FetchPage(PagePosition page_position) override;
+  virtual Frame* FetchPage(PagePosition page_position,
+                           ScanRing* ring) override;
+  virtual Frame* NewPage(PagePosition page_position) override;
+  virtual void ReleaseScanRing(ScanRing* ring) override;
+  virtual void UnPinPage(PagePosition page_position) override;
+  virtual void UnPinPage(Frame* frame) override;
+  virtual bool FlushPage(PagePosition page_position) override;
+  virtual void FlushAllPage() override;
+  virtual void MarkDirty(Frame* frame) override;
+  virtual size_t MaxPinnedPages(space_t space) override;
+  virtual bool ReadPageOptimistic(PagePosition page_position,
+                                  const OptimisticReader& reader) override;
+  virtual void Prefetch(PagePosition page_position) override;
+  virtual void Prefetch(PagePosition page_position, ScanRing* ring) override;
+  virtual void Prefetch(const vector<PagePosition>& page_positions) override;
+
+ public:
+  /**
+   * @brief 页面大小对应的缓冲池
+   *
+   * @param page_size 页面大小
+   * @return IBufferPool* 没有配置该尺寸级别时为 nullptr
+   */
+  IBufferPool* SizeClass(size_t page_size) const;
+
+ public:
+  // MIN_PAGE_SIZE 到 MAX_PAGE_SIZE 之间2的幂的个数
+  static const size_t SIZE_CLASSES = 5;
+
+ private:
+  /**
+   * @brief 页面所在表空间的页面大小对应的缓冲池
+   *
+   * @param page_position 页面位置
+   * @return IBufferPool*
+   */
+  IBufferPool* SizeClassOf(const PagePosition& page_position) const;
+
+ private:
+  // 下标为 log2(page_size / MIN_PAGE_SIZE)
+  IBufferPool* classes_[SIZE_CLASSES];
+};
+
+#endif
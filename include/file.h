@@ -1,21 +1,32 @@
 #pragma once
 
-#include <fstream>
+#include <atomic>
 #include <iostream>
 #include <mutex>
 #include <string>
 
+using std::atomic;
 using std::cout;
 using std::endl;
-using std::fstream;
 using std::lock_guard;
 using std::mutex;
 using std::string;
 
+struct iovec;
+
+/**
+ * @brief 基于文件描述符的文件
+ *
+ * 数据读写使用 pread/pwrite 定位读写, 不修改文件偏移量, 因此不需要加锁,
+ * 同一文件上不同位置的读写可以并行执行. 文件长度在打开时读取一次并缓存.
+ *
+ * 直接I/O模式下使用 O_DIRECT 绕过内核页缓存, 位置、长度和缓冲区按
+ * IO_BLOCK_SIZE 对齐的读写直接下发, 未对齐的读写经过对齐的中转缓冲区.
+ */
 class File {
  public:
   File() = default;
-  File(const std::string &db_file);
+  File(const std::string &db_file, bool direct_io = false);
   File(const File &other) = delete;
   // File(const File &&other) = default;
   ~File();
@@ -35,10 +46,11 @@ class File {
    * @brief 打开文件
    *
    * @param db_file 文件名
+   * @param direct_io 是否使用直接I/O
    * @return true  成功
    * @return false 失败
    */
-  bool open(const std::string &db_file);
+  bool open(const std::string &db_file, bool direct_io = false);
 
   /**
    * @brief 文件是否打开成功
@@ -48,11 +60,19 @@ class File {
    */
   bool is_open() const;
 
+  /**
+   * @brief 是否使用直接I/O
+   *
+   * @return true
+   * @return false
+   */
+  bool is_direct_io() const;
+
   /**
    * @brief 从文件中申请指定大小的磁盘空间
    *
    * @param size 申请空间
-   * @return size_t
+   * @return size_t 申请空间的起始位置
    */
   size_t alloc(const size_t size);
 
@@ -78,22 +98,45 @@ class File {
   T read(int pos);
 
   /**
-   * @brief
+   * @brief 从文件读取数据, 超出文件长度的部分填充0
    *
-   * @param pos
-   * @param buffer
-   * @param size
+   * @param pos 文件位置
+   * @param buffer 缓冲区
+   * @param size 读取大小
+   * @return size_t 实际从文件读取的大小
    */
-  void read(size_t pos, char *buffer, size_t size);
+  size_t read(size_t pos, char *buffer, size_t size);
+
+  /**
+   * @brief 从 pos 开始的连续位置读入多个缓冲区, 使用 preadv 合并读取,
+   * 超出文件长度的部分填充0
+   *
+   * @param pos 文件位置
+   * @param iov 缓冲区
+   * @param iovcnt 缓冲区数量
+   * @return size_t 实际从文件读取的大小
+   */
+  size_t readv(size_t pos, const iovec *iov, size_t iovcnt);
 
   /**
    * @brief 向文件写入数据
    *
-   * @param pos
-   * @param data
-   * @param size
+   * @param pos 文件位置
+   * @param data 数据
+   * @param size 数据长度
+   * @return size_t 实际写入的大小
    */
-  void write(size_t pos, const char *data, size_t size);
+  size_t write(size_t pos, const char *data, size_t size);
+
+  /**
+   * @brief 将多个缓冲区写入从 pos 开始的连续位置, 使用 pwritev 合并写入
+   *
+   * @param pos 文件位置
+   * @param iov 缓冲区
+   * @param iovcnt 缓冲区数量
+   * @return size_t 实际写入的大小
+   */
+  size_t writev(size_t pos, const iovec *iov, size_t iovcnt);
 
   /**
    * @brief 向文件中写入对象
@@ -119,26 +162,70 @@ class File {
    */
   int64_t size();
 
+  /**
+   * @brief 文件描述符, 供异步I/O直接提交请求
+   *
+   * @return int
+   */
+  int fd() const;
+
+  /**
+   * @brief 读写是否满足直接I/O的对齐要求
+   *
+   * @param pos 文件位置
+   * @param buffer 缓冲区
+   * @param size 大小
+   * @return true
+   * @return false
+   */
+  bool aligned(size_t pos, const char *buffer, size_t size) const;
+
+  /**
+   * @brief 写入后更新缓存的文件长度
+   *
+   * @param end 写入结束位置
+   */
+  void extend(int64_t end);
+
  private:
-  size_t last_pos();
+  /**
+   * @brief 通过对齐的中转缓冲区读取数据
+   *
+   * @param pos 文件位置
+   * @param buffer 缓冲区
+   * @param size 读取大小
+   * @return size_t
+   */
+  size_t unaligned_read(size_t pos, char *buffer, size_t size);
+
+  /**
+   * @brief 通过对齐的中转缓冲区写入数据, 先读出覆盖的块再整体写回
+   *
+   * @param pos 文件位置
+   * @param data 数据
+   * @param size 数据长度
+   * @return size_t
+   */
+  size_t unaligned_write(size_t pos, const char *data, size_t size);
+
+  size_t pread_full(size_t pos, char *buffer, size_t size);
+  size_t pwrite_full(size_t pos, const char *data, size_t size);
 
  private:
-  fstream handle_;
+  int fd_ = -1;
+  bool direct_io_ = false;
+  atomic<int64_t> file_size_ = 0;
   string db_file_name_;
   mutex _file_lock;
-  const size_t MARK = 1;
 };
 
 template <typename T>
 void File::read(int pos, T *obj, size_t size) {
-  lock_guard guard(_file_lock);
-  handle_.seekg(pos);
-  handle_.read(reinterpret_cast<char *>(obj), size);
+  read(static_cast<size_t>(pos), reinterpret_cast<char *>(obj), size);
 }
 
 template <typename T>
 T File::read(int pos) {
-  lock_guard guard(_file_lock);
   T obj;
   read(pos, &obj, sizeof(T));
   return obj;
@@ -149,7 +236,5 @@ void File::write(int pos, const T *obj, size_t size) {
   if (size <= 0) {
     size = sizeof(T);
   }
-  lock_guard guard(_file_lock);
-  handle_.seekp(pos);
-  handle_.write((char *)obj, size);
-}
\ No newline at end of file
+  write(static_cast<size_t>(pos), reinterpret_cast<const char *>(obj), size);
+}
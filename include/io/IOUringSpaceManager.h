@@ -0,0 +1,174 @@
+#pragma once
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "basetype.h"
+#include "io/SpaceManager.h"
+
+using std::condition_variable;
+using std::future;
+using std::mutex;
+using std::promise;
+using std::thread;
+
+class File;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @brief 基于 io_uring 的异步表空间管理
+ *
+ * 直接使用 io_uring_setup/io_uring_enter 系统调用, 不依赖 liburing.
+ * 请求先写入提交队列, 攒够 batch_size 个或调用 Submit 时一次性提交;
+ * 后台线程收割完成队列, 调用回调并设置 future 的结果.
+ * 读写不完整时收割线程重新提交剩余部分; 读到文件尾时剩余部分填0,
+ * 出错时 future 的结果为出错前完成的字节数, 调用方据此判断是否失败.
+ *
+ * 表空间文件由 TableSpaceDiskManager 统一打开和管理. 内核不支持
+ * io_uring 时退化为同步读写.
+ */
+class IOUringSpaceManager : public IAsyncSpaceManager {
+ public:
+  IOUringSpaceManager(unsigned entries = DEFAULT_ENTRIES,
+                      unsigned batch_size = DEFAULT_BATCH_SIZE);
+  IOUringSpaceManager(const IOUringSpaceManager &other) = delete;
+  IOUringSpaceManager(const IOUringSpaceManager &&other) = delete;
+  virtual ~IOUringSpaceManager();
+
+ public:
+  virtual size_t read(space_t space, address_t address, char *buffer,
+                      size_t buffer_size) override;
+  virtual size_t write(space_t space, address_t address, const char *buffer,
+                       size_t buffer_size) override;
+  virtual size_t size(space_t space) override;
+
+  virtual future<size_t> AsyncRead(space_t space, address_t address,
+                                   char *buffer, size_t buffer_size,
+                                   IOCallback callback = nullptr) override;
+  virtual future<size_t> AsyncWrite(space_t space, address_t address,
+                                    const char *buffer, size_t buffer_size,
+                                    IOCallback callback = nullptr) override;
+  virtual void Submit() override;
+
+  /**
+   * @brief io_uring 是否初始化成功
+   *
+   * @return true
+   * @return false
+   */
+  bool is_open() const;
+
+ public:
+  static const unsigned DEFAULT_ENTRIES = 256;
+  static const unsigned DEFAULT_BATCH_SIZE = 32;
+
+ private:
+  struct Request {
+    Request(File *file, address_t address, char *buffer, size_t buffer_size,
+            bool is_write, IOCallback callback)
+        : file(file),
+          address(address),
+          buffer(buffer),
+          buffer_size(buffer_size),
+          is_write(is_write),
+          callback(std::move(callback)) {}
+
+    File *file;
+    address_t address;
+    char *buffer;
+    size_t buffer_size;
+    bool is_write;
+    IOCallback callback;
+    promise<size_t> result;
+    // 已完成的字节数, 不完整的读写从这里继续
+    size_t done = 0;
+  };
+
+  bool Setup(unsigned entries);
+
+  /**
+   * @brief 将请求放入提交队列
+   *
+   * @param request 请求
+   * @return future<size_t>
+   */
+  future<size_t> Enqueue(Request *request);
+
+  /**
+   * @brief 将请求未完成的部分写入提交队列, 调用方需持有 submit_lock_
+   *
+   * @param request 请求
+   */
+  void PushLocked(Request *request);
+
+  /**
+   * @brief 累计内核返回的结果, 判断请求是否需要重新提交
+   *
+   * @param request 请求
+   * @param result 内核返回的结果
+   * @return true 请求还有未完成的部分
+   * @return false 请求已完成或出错
+   */
+  bool Advance(Request *request, int result);
+
+  /**
+   * @brief 提交队列中的请求, 调用方需持有 submit_lock_
+   *
+   */
+  void SubmitLocked();
+
+  /**
+   * @brief 同步完成请求
+   *
+   * @param request 请求
+   */
+  void Execute(Request *request);
+
+  /**
+   * @brief 请求完成处理, 以已完成的字节数设置 future 的结果
+   *
+   * @param request 请求
+   */
+  void Complete(Request *request);
+
+  /**
+   * @brief 收割完成队列
+   *
+   */
+  void Reap();
+
+ private:
+  int ring_fd_;
+  unsigned batch_size_;
+
+  // 提交队列
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_ring_mask_;
+  unsigned *sq_array_;
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned sq_entries_;
+
+  // 完成队列
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_ring_mask_;
+  io_uring_cqe *cqes_;
+  unsigned cq_entries_;
+
+  mutex submit_lock_;
+  condition_variable inflight_cv_;
+  unsigned unsubmitted_;
+  unsigned inflight_;
+
+  thread reaper_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "basetype.h"
+#include "io/SpaceManager.h"
+
+using std::shared_mutex;
+using std::unordered_map;
+
+/**
+ * @brief 基于内存映射的只读表空间管理
+ *
+ * 表空间文件在第一次访问时整体映射到内存, 之后的读取直接访问映射区域,
+ * 不经过 read 系统调用. 映射使用 MAP_PRIVATE, 对映射页面的修改只在
+ * 进程内可见(写时复制), 不会写回文件, 适用于只读的索引快照.
+ *
+ * 映射的长度为第一次映射时的文件大小, 之后文件增长的部分不可见;
+ * 文件不存在或为空时不缓存映射, 下次访问时重试.
+ */
+class MMapSpaceManager : public ISpaceManager {
+ private:
+  MMapSpaceManager() = default;
+  MMapSpaceManager(const MMapSpaceManager& other) = delete;
+  MMapSpaceManager(const MMapSpaceManager&& other) = delete;
+  ~MMapSpaceManager();
+
+ public:
+  STATIC_SINGLE_INSTANCE(MMapSpaceManager);
+
+ public:
+  size_t read(space_t space, address_t address, char* buffer,
+              size_t buffer_size) override;
+
+  /**
+   * @brief 只读表空间不支持写入
+   *
+   * @return size_t 始终返回0
+   */
+  size_t write(space_t space, address_t address, const char* buffer,
+               size_t buffer_size) override;
+
+  /**
+   * @brief 获取表空间中指定位置在映射区域中的地址
+   *
+   * @param space 表空间
+   * @param address 表空间内地址
+   * @param size 访问大小
+   * @return char* 超出映射范围时返回 nullptr
+   */
+  char* Address(space_t space, address_t address, size_t size);
+
+ private:
+  struct Mapping {
+    char* base;
+    size_t length;
+  };
+
+  /**
+   * @brief 获取表空间的映射, 不存在则建立映射
+   *
+   * @param space 表空间
+   * @return Mapping 映射失败时为 {nullptr, 0}
+   */
+  Mapping getMapping(space_t space);
+
+ private:
+  unordered_map<space_t, Mapping> mappings_;
+  shared_mutex mapping_lock_;
+};
@@ -1,9 +1,103 @@
 #pragma once
 
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "basetype.h"
+
+using std::function;
+using std::future;
+using std::vector;
+
 class ISpaceManager {
  public:
   virtual size_t read(space_t space, address_t address, char *buffer,
                       size_t buffer_size) = 0;
   virtual size_t write(space_t space, address_t address, const char *buffer,
                        size_t buffer_size) = 0;
-};
\ No newline at end of file
+  virtual ~ISpaceManager() = default;
+
+  /**
+   * @brief 表空间的长度, 读取不完整时用于区分读到文件尾和读取出错
+   *
+   * 默认为0, 不完整的读取都视为读到文件尾
+   *
+   * @param space 表空间
+   * @return size_t
+   */
+  virtual size_t size(space_t) { return 0; }
+
+  /**
+   * @brief 从 address 开始的连续位置读入多个等长缓冲区
+   *
+   * 默认逐个读取, 支持向量化读的实现可以合并为一次系统调用
+   *
+   * @param space 表空间
+   * @param address 起始位置
+   * @param buffers 缓冲区
+   * @param buffer_size 每个缓冲区的大小
+   * @return size_t 实际读取的字节数
+   */
+  virtual size_t readv(space_t space, address_t address,
+                       const vector<char *> &buffers, size_t buffer_size) {
+    size_t done = 0;
+    for (auto buffer : buffers) {
+      done += this->read(space, address + done, buffer, buffer_size);
+    }
+    return done;
+  }
+
+  /**
+   * @brief 将多个等长缓冲区写入从 address 开始的连续位置
+   *
+   * 默认逐个写入, 支持向量化写的实现可以合并为一次系统调用
+   *
+   * @param space 表空间
+   * @param address 起始位置
+   * @param buffers 缓冲区
+   * @param buffer_size 每个缓冲区的大小
+   * @return size_t 实际写入的字节数
+   */
+  virtual size_t writev(space_t space, address_t address,
+                        const vector<const char *> &buffers,
+                        size_t buffer_size) {
+    size_t done = 0;
+    for (auto buffer : buffers) {
+      size_t n = this->write(space, address + done, buffer, buffer_size);
+      done += n;
+      if (n < buffer_size) {
+        break;
+      }
+    }
+    return done;
+  }
+};
+
+/**
+ * @brief I/O完成回调, 参数为实际读写的字节数
+ */
+using IOCallback = function<void(size_t)>;
+
+/**
+ * @brief 异步表空间管理
+ *
+ * 异步读写只负责将请求放入提交队列, 调用 Submit 后批量提交给内核;
+ * 请求完成时先调用回调, 再设置 future 的结果. 在请求完成前, 调用方需要
+ * 保证缓冲区有效.
+ */
+class IAsyncSpaceManager : public ISpaceManager {
+ public:
+  virtual future<size_t> AsyncRead(space_t space, address_t address,
+                                   char *buffer, size_t buffer_size,
+                                   IOCallback callback = nullptr) = 0;
+  virtual future<size_t> AsyncWrite(space_t space, address_t address,
+                                    const char *buffer, size_t buffer_size,
+                                    IOCallback callback = nullptr) = 0;
+
+  /**
+   * @brief 提交队列中尚未提交的请求
+   *
+   */
+  virtual void Submit() = 0;
+};
@@ -1,26 +1,25 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
-#include <unordered_map>
 
 #include "basetype.h"
 #include "io/SpaceManager.h"
 
+using std::atomic;
 using std::mutex;
 
 class File;
 
-using std::unordered_map;
-
-#define STATIC_SINGLE_INSTANCE(type) \
-  static type* Instance() {          \
-    static type obj;                 \
-    return &obj;                     \
-  }
-
+/**
+ * @brief 基于文件的表空间管理
+ *
+ * 表空间文件按编号保存在数组中, 第一次访问时打开; 之后的读写按下标
+ * 取文件, 不加锁也不查哈希表.
+ */
 class TableSpaceDiskManager : public ISpaceManager {
  private:
-  TableSpaceDiskManager() = default;
+  TableSpaceDiskManager();
   TableSpaceDiskManager(const TableSpaceDiskManager& other) = delete;
   TableSpaceDiskManager(const TableSpaceDiskManager&& other) = delete;
 
@@ -32,11 +31,34 @@ class TableSpaceDiskManager : public ISpaceManager {
               size_t buffer_size);
   size_t write(space_t space, address_t address, const char* buffer,
                size_t buffer_size);
+  size_t readv(space_t space, address_t address,
+               const vector<char*>& buffers, size_t buffer_size) override;
+  size_t writev(space_t space, address_t address,
+                const vector<const char*>& buffers,
+                size_t buffer_size) override;
+  size_t size(space_t space) override;
 
- private:
+  /**
+   * @brief 开启或关闭直接I/O, 只影响之后打开的表空间文件
+   *
+   * 开启后页面不再经过内核页缓存, 由缓冲池独占缓存页面,
+   * 页面读写需要使用按 IO_BLOCK_SIZE 对齐的缓冲区和地址
+   *
+   * @param enable 是否开启
+   */
+  void EnableDirectIO(bool enable);
+
+  /**
+   * @brief 获取表空间对应的文件, 不存在则打开
+   *
+   * @param space 表空间编号
+   * @return File* 编号未注册时为 nullptr
+   */
   File* getFile(space_t space);
 
  private:
-  unordered_map<space_t, File*> files_;
-  mutex fetch_file_lock_;
+  // 按表空间编号索引, 打开后不再修改
+  atomic<File*>* files_;
+  mutex open_lock_;
+  bool direct_io_ = false;
 };
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#ifndef TABLE_SPACE_REGISTRY_H
+#define TABLE_SPACE_REGISTRY_H
+
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "basetype.h"
+
+using std::atomic;
+using std::shared_mutex;
+using std::string;
+using std::unordered_map;
+
+/**
+ * @brief 表空间注册表, 为表空间文件名分配整数编号
+ *
+ * 编号从0开始连续分配, 在进程内不会回收, 缓冲池和表空间管理都按编号
+ * 索引表空间. 注册在互斥锁下查找文件名, 只在打开索引等低频路径调用;
+ * 按编号取文件名只读取数组, 不加锁. 编号在进程重启后不保证相同,
+ * 需要持久化的地方保存文件名.
+ *
+ * 每个表空间有自己的页面大小, 由创建表空间的索引设置, 缓冲池按它选择
+ * 帧的尺寸级别.
+ */
+class TableSpaceRegistry {
+ private:
+  TableSpaceRegistry();
+  TableSpaceRegistry(const TableSpaceRegistry& other) = delete;
+  TableSpaceRegistry(const TableSpaceRegistry&& other) = delete;
+  ~TableSpaceRegistry();
+
+ public:
+  STATIC_SINGLE_INSTANCE(TableSpaceRegistry);
+
+ public:
+  /**
+   * @brief 注册表空间, 已注册的文件名返回原来的编号
+   *
+   * @param name 表空间文件名
+   * @return space_t 表空间编号, 超过 MAX_SPACES 时返回 INVALID_SPACE
+   */
+  space_t Register(const string& name);
+
+  /**
+   * @brief 表空间文件名
+   *
+   * @param space 已注册的表空间编号
+   * @return const string&
+   */
+  const string& Name(space_t space) const;
+
+  /**
+   * @brief 设置表空间的页面大小
+   *
+   * @param space 已注册的表空间编号
+   * @param page_size 页面大小
+   * @return true 设置成功
+   * @return false 编号无效或页面大小不合法
+   */
+  bool SetPageSize(space_t space, size_t page_size);
+
+  /**
+   * @brief 表空间的页面大小, 不加锁
+   *
+   * @param space 表空间编号
+   * @return size_t 未设置时为 PAGE_SIZE
+   */
+  size_t PageSize(space_t space) const;
+
+  /**
+   * @brief 页面大小是否是 MIN_PAGE_SIZE 到 MAX_PAGE_SIZE 之间的2的幂
+   *
+   * @param page_size 页面大小
+   * @return true
+   * @return false
+   */
+  static bool ValidPageSize(size_t page_size);
+
+  /**
+   * @brief 已注册的表空间数量
+   *
+   * @return size_t
+   */
+  size_t size() const;
+
+ public:
+  static const space_t MAX_SPACES = 4096;
+  static const space_t INVALID_SPACE = static_cast<space_t>(-1);
+
+ private:
+  unordered_map<string, space_t> spaces_;
+  // 按编号索引的文件名, 注册后不再修改
+  atomic<const string*>* names_;
+  // 按编号索引的页面大小, 0 表示未设置
+  atomic<uint32_t>* page_sizes_;
+  atomic<size_t> size_;
+  shared_mutex lock_;
+};
+
+#endif
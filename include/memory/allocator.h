@@ -1,29 +1,300 @@
 #ifndef FIXED_ALLOCATOR_H
 #define FIXED_ALLOCATOR_H
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
-#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#include "basetype.h"
 
 using std::atomic;
-using std::vector;
+using std::lock_guard;
+using std::mutex;
 
+/**
+ * @brief 定长内存块分配器
+ *
+ * 内存块按 ALIGNMENT 对齐, 从每次申请约 SLAB_SIZE 的内存段(slab)中切分,
+ * 释放的内存块放回空闲链表, 不归还给系统, 分配器析构时统一释放.
+ *
+ * 空闲链表是按块编号链接的无锁栈, 栈顶带版本号避免 ABA. 每个线程缓存
+ * 最多 2 * CACHE_BLOCKS 个内存块, 缓存为空或已满时与空闲链表成批交换,
+ * 大多数分配和释放不访问共享的缓存行. 只有空闲链表为空需要申请新的
+ * 内存段时加锁.
+ *
+ * 线程缓存按分配器类型区分, 同一类型通常只使用一个实例(见 Instance).
+ * 分配器需要比使用它的线程存活更久, 线程退出时缓存的内存块还给分配器.
+ *
+ * @tparam MEMORY_SIZE 内存块大小
+ */
 template <size_t MEMORY_SIZE> class FixedAllocator {
 public:
-  FixedAllocator(size_t initial_capacity = 10)
-      : buffers_(10), alloc_pos_(0), dealloc_pos_(0) {}
+  FixedAllocator(size_t initial_capacity = DEFAULT_INITIAL_CAPACITY)
+      : slab_count_(0), head_(0) {
+    slabs_ = new atomic<char *>[MAX_SLABS];
+    for (size_t i = 0; i < MAX_SLABS; i++) {
+      slabs_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    while (this->capacity() < initial_capacity) {
+      this->Dealloc(this->Grow());
+    }
+  }
+  FixedAllocator(const FixedAllocator &other) = delete;
+  FixedAllocator &operator=(const FixedAllocator &other) = delete;
+
+  ~FixedAllocator() {
+    ThreadCache &cache = Cache();
+    if (cache.owner == this) {
+      cache.owner = nullptr;
+      cache.size = 0;
+    }
+    size_t slab_count = slab_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < slab_count; i++) {
+      std::free(slabs_[i].load(std::memory_order_relaxed));
+    }
+    delete[] slabs_;
+  }
+
+  STATIC_SINGLE_INSTANCE(FixedAllocator);
 
-  char *Alloc() {}
+  /**
+   * @brief 分配一个内存块
+   *
+   * @return char* MEMORY_SIZE 大小的内存块, 内容未初始化
+   */
+  char *Alloc() {
+    ThreadCache &cache = this->Acquire();
+    if (cache.size == 0) {
+      // 从空闲链表取一批, 空闲链表为空时申请新的内存段
+      while (cache.size < CACHE_BLOCKS) {
+        uint32_t index = this->Pop();
+        if (index == INVALID_BLOCK) {
+          break;
+        }
+        cache.blocks[cache.size++] = index;
+      }
+      if (cache.size == 0) {
+        return this->Grow();
+      }
+    }
+    return this->block(cache.blocks[--cache.size]);
+  }
 
-  void Dealloc() {}
+  /**
+   * @brief 释放内存块
+   *
+   * @param buffer Alloc 分配的内存块
+   */
+  void Dealloc(char *buffer) {
+    if (buffer == nullptr) {
+      return;
+    }
+    ThreadCache &cache = this->Acquire();
+    if (cache.size == 2 * CACHE_BLOCKS) {
+      this->Flush(cache, CACHE_BLOCKS);
+    }
+    cache.blocks[cache.size++] = header(buffer)->index;
+  }
+
+  /**
+   * @brief 已申请的内存块数量, 包括正在使用和空闲的
+   *
+   * @return size_t
+   */
+  size_t capacity() const {
+    return slab_count_.load(std::memory_order_acquire) * SLAB_BLOCKS;
+  }
 
 public:
-  static const int DEFAULT_INITIAL_CAPACITY = 0;
+  static const size_t DEFAULT_INITIAL_CAPACITY = 0;
+  static const size_t ALIGNMENT = 64;
+  static const size_t SLAB_SIZE = 1024 * 1024;
+  static const size_t MAX_SLABS = 4096;
+  static const size_t CACHE_BLOCKS = 8;
 
 private:
-  vector<char *> buffers_;
-  atomic<uint64_t> alloc_pos_;
-  atomic<uint64_t> dealloc_pos_;
+  /**
+   * @brief 内存块头部, 位于内存块之前, 分配出去后仍由分配器使用
+   */
+  struct Header {
+    // 空闲链表中下一个块的编号加1, 0 表示链表结束
+    atomic<uint32_t> next;
+    uint32_t index;
+  };
+
+  struct ThreadCache {
+    FixedAllocator *owner = nullptr;
+    size_t size = 0;
+    uint32_t blocks[2 * CACHE_BLOCKS];
+
+    ~ThreadCache() {
+      if (owner != nullptr) {
+        owner->Flush(*this, size);
+      }
+    }
+  };
+
+  // 每个块占用的空间, 头部单独占一个对齐单位
+  static constexpr size_t STRIDE =
+      ALIGNMENT + (MEMORY_SIZE + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  static constexpr size_t SLAB_BLOCKS = std::max<size_t>(SLAB_SIZE / STRIDE, 1);
+  static constexpr uint32_t INVALID_BLOCK = static_cast<uint32_t>(-1);
+  static constexpr uint64_t INDEX_MASK = 0xffffffffULL;
+
+  static_assert(sizeof(Header) <= ALIGNMENT);
+  static_assert(MAX_SLABS * SLAB_BLOCKS < INVALID_BLOCK);
+
+  static ThreadCache &Cache() {
+    static thread_local ThreadCache cache;
+    return cache;
+  }
+
+  /**
+   * @brief 当前线程的缓存, 缓存属于其他实例时先还给原来的实例
+   */
+  ThreadCache &Acquire() {
+    ThreadCache &cache = Cache();
+    if (cache.owner != this) {
+      if (cache.owner != nullptr) {
+        cache.owner->Flush(cache, cache.size);
+      }
+      cache.owner = this;
+    }
+    return cache;
+  }
+
+  /**
+   * @brief 将线程缓存末尾的 count 个块还给空闲链表
+   */
+  void Flush(ThreadCache &cache, size_t count) {
+    for (; count > 0; count--) {
+      this->Push(cache.blocks[--cache.size]);
+    }
+  }
+
+  Header *header(uint32_t index) const {
+    char *slab = slabs_[index / SLAB_BLOCKS].load(std::memory_order_acquire);
+    return reinterpret_cast<Header *>(slab + index % SLAB_BLOCKS * STRIDE);
+  }
+
+  static Header *header(char *buffer) {
+    return reinterpret_cast<Header *>(buffer - ALIGNMENT);
+  }
+
+  char *block(uint32_t index) const {
+    return reinterpret_cast<char *>(header(index)) + ALIGNMENT;
+  }
+
+  uint32_t Pop() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (true) {
+      uint32_t top = head & INDEX_MASK;
+      if (top == 0) {
+        return INVALID_BLOCK;
+      }
+      // 块头部不会被使用者覆盖, 栈顶已被其他线程取走时读到的 next 无效,
+      // 但版本号变化使下面的 CAS 失败
+      uint32_t next = header(top - 1)->next.load(std::memory_order_relaxed);
+      uint64_t new_head = ((head >> 32) + 1) << 32 | next;
+      if (head_.compare_exchange_weak(head, new_head,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        return top - 1;
+      }
+    }
+  }
+
+  void Push(uint32_t index) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    while (true) {
+      header(index)->next.store(head & INDEX_MASK, std::memory_order_relaxed);
+      uint64_t new_head = ((head >> 32) + 1) << 32 | (index + 1);
+      if (head_.compare_exchange_weak(head, new_head,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief 申请新的内存段, 第一个块返回给调用方, 其余放入空闲链表
+   */
+  char *Grow() {
+    lock_guard<mutex> guard(grow_lock_);
+    size_t slab_no = slab_count_.load(std::memory_order_relaxed);
+    if (slab_no >= MAX_SLABS) {
+      throw std::bad_alloc();
+    }
+    char *slab = static_cast<char *>(
+        std::aligned_alloc(ALIGNMENT, SLAB_BLOCKS * STRIDE));
+    if (slab == nullptr) {
+      throw std::bad_alloc();
+    }
+    uint32_t first = slab_no * SLAB_BLOCKS;
+    for (size_t i = 0; i < SLAB_BLOCKS; i++) {
+      new (slab + i * STRIDE) Header{{0}, static_cast<uint32_t>(first + i)};
+    }
+    slabs_[slab_no].store(slab, std::memory_order_release);
+    slab_count_.store(slab_no + 1, std::memory_order_release);
+    for (size_t i = 1; i < SLAB_BLOCKS; i++) {
+      this->Push(first + i);
+    }
+    return this->block(first);
+  }
+
+private:
+  atomic<char *> *slabs_;
+  atomic<size_t> slab_count_;
+  // 低32位为栈顶块编号加1, 高32位为版本号
+  atomic<uint64_t> head_;
+  mutex grow_lock_;
+};
+
+/**
+ * @brief 页面大小的临时缓冲区
+ *
+ * 按页面大小选择对应的 FixedAllocator, 不是合法页面大小时直接 new.
+ */
+class PageBufferAllocator {
+public:
+  static char *Alloc(size_t page_size) {
+    switch (page_size) {
+    case 4 * 1024:
+      return FixedAllocator<4 * 1024>::Instance()->Alloc();
+    case 8 * 1024:
+      return FixedAllocator<8 * 1024>::Instance()->Alloc();
+    case 16 * 1024:
+      return FixedAllocator<16 * 1024>::Instance()->Alloc();
+    case 32 * 1024:
+      return FixedAllocator<32 * 1024>::Instance()->Alloc();
+    case 64 * 1024:
+      return FixedAllocator<64 * 1024>::Instance()->Alloc();
+    default:
+      return new char[page_size];
+    }
+  }
+
+  static void Dealloc(char *buffer, size_t page_size) {
+    switch (page_size) {
+    case 4 * 1024:
+      return FixedAllocator<4 * 1024>::Instance()->Dealloc(buffer);
+    case 8 * 1024:
+      return FixedAllocator<8 * 1024>::Instance()->Dealloc(buffer);
+    case 16 * 1024:
+      return FixedAllocator<16 * 1024>::Instance()->Dealloc(buffer);
+    case 32 * 1024:
+      return FixedAllocator<32 * 1024>::Instance()->Dealloc(buffer);
+    case 64 * 1024:
+      return FixedAllocator<64 * 1024>::Instance()->Dealloc(buffer);
+    default:
+      delete[] buffer;
+    }
+  }
 };
 
-#endif
\ No newline at end of file
+#endif
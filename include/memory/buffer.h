@@ -2,26 +2,32 @@
 #define BUFFER_H
 
 #include <cstddef>
-#include <iostream>
+#include <cstring>
+#include <new>
 #include <type_traits>
 #include <utility>
 
 #include "base.h"
+#include "memory/ref.h"
 
-using std::cout;
 using std::enable_if_t;
-using std::endl;
 using std::is_base_of_v;
 using std::move;
 
+/**
+ * @brief 带引用计数的共享缓冲区
+ *
+ * 引用计数和缓冲区在同一次分配中, 计数位于缓冲区之前. 拷贝只增加
+ * 原子计数, 移动不修改计数, 最后一个持有者释放内存.
+ *
+ * @tparam T 缓冲区中的对象类型
+ */
 template <typename T> class SharedBuffer {
 public:
   template <typename... Args>
   SharedBuffer(size_t buffer_size = sizeof(T), Args... args)
       : buffer_size_(buffer_size) {
-    cout << "SharedBuffer" << endl;
-    reference_count_ = new size_t(1);
-    buffer_ = new char[buffer_size_];
+    buffer_ = Allocate(buffer_size_);
     memset(buffer_, 0, buffer_size_);
     Constructor<T>::construct(buffer_, args...);
   }
@@ -29,38 +35,40 @@ public:
   template <typename... Args> void Reset(size_t buffer_size, Args... args) {
     DecrementReference();
     buffer_size_ = buffer_size;
-    reference_count_ = new size_t(1);
-    buffer_ = new char[buffer_size_];
+    buffer_ = Allocate(buffer_size_);
     Constructor<T>::construct(buffer_, args...);
   }
 
-  SharedBuffer(const SharedBuffer &other) {
-    this->reference_count_ = other.reference_count_;
-    this->buffer_ = other.buffer_;
+  SharedBuffer(const SharedBuffer &other)
+      : buffer_size_(other.buffer_size_), buffer_(other.buffer_) {
     this->IncrementReference();
   }
 
   SharedBuffer &operator=(const SharedBuffer &other) {
-    // 原始引用减一
-    this->DecrementReference();
-    this->reference_count_ = other.reference_count_;
-    this->buffer_ = other.buffer_;
-    this->IncrementReference();
-    cout << "copy assign: reference_count:" << *(this->reference_count_)
-         << endl;
+    if (this->buffer_ != other.buffer_) {
+      // 先增加新引用, 再减少原始引用
+      if (other.buffer_ != nullptr) {
+        reference(other.buffer_)->IncrementReference();
+      }
+      this->DecrementReference();
+      this->buffer_size_ = other.buffer_size_;
+      this->buffer_ = other.buffer_;
+    }
     return *this;
   }
 
-  SharedBuffer(const SharedBuffer &&other) {
-    this->DecrementReference();
-    this->reference_count_ = other.reference_count_;
-    this->buffer_ = other.buffer_;
+  SharedBuffer(SharedBuffer &&other) noexcept
+      : buffer_size_(other.buffer_size_), buffer_(other.buffer_) {
+    other.buffer_ = nullptr;
   }
 
-  SharedBuffer &operator=(const SharedBuffer &&other) {
-    this->DecrementReference();
-    this->reference_count_ = other.reference_count_;
-    this->buffer_ = other.buffer_;
+  SharedBuffer &operator=(SharedBuffer &&other) noexcept {
+    if (this != &other) {
+      this->DecrementReference();
+      this->buffer_size_ = other.buffer_size_;
+      this->buffer_ = other.buffer_;
+      other.buffer_ = nullptr;
+    }
     return *this;
   }
 
@@ -73,31 +81,49 @@ public:
 
   ~SharedBuffer() { DecrementReference(); }
 
-  int reference_count() { return *(this->reference_count_); }
+  int reference_count() {
+    return buffer_ == nullptr ? 0 : reference(buffer_)->reference_count();
+  }
 
   char *buffer() { return buffer_; }
 
 public:
   void DecrementReference() {
-    if (reference_count_ != nullptr) {
-      --(*reference_count_);
-      cout << "Delete:" << (*reference_count_) << endl;
-      if (*reference_count_ == 0) {
-        cout << "Delete" << endl;
-        delete reference_count_;
-        delete[] buffer_;
-        reference_count_ = nullptr;
-        buffer_ = nullptr;
+    if (buffer_ != nullptr) {
+      Reference *ref = reference(buffer_);
+      if (ref->DecrementReference() == 0) {
+        ref->~Reference();
+        delete[] reinterpret_cast<char *>(ref);
       }
+      buffer_ = nullptr;
+    }
+  }
+
+  void IncrementReference() {
+    if (buffer_ != nullptr) {
+      reference(buffer_)->IncrementReference();
     }
   }
 
-  void IncrementReference() { ++(*(this->reference_count_)); }
+private:
+  // 引用计数占用的空间, 保持缓冲区按 max_align_t 对齐
+  static constexpr size_t HEADER_SIZE =
+      (sizeof(Reference) + alignof(std::max_align_t) - 1) /
+      alignof(std::max_align_t) * alignof(std::max_align_t);
+
+  static char *Allocate(size_t buffer_size) {
+    char *address = new char[HEADER_SIZE + buffer_size];
+    new (address) Reference();
+    return address + HEADER_SIZE;
+  }
+
+  static Reference *reference(char *buffer) {
+    return reinterpret_cast<Reference *>(buffer - HEADER_SIZE);
+  }
 
 private:
   size_t buffer_size_;
-  size_t *reference_count_;
   char *buffer_;
 };
 
-#endif
\ No newline at end of file
+#endif
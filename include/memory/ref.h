@@ -3,48 +3,51 @@
 
 #include <atomic>
 #include <cstddef>
-#include <mutex>
 
-using std::lock_guard;
-using std::mutex;
-
-// todo 线程安全Reference
+using std::atomic;
 
+/**
+ * @brief 侵入式引用计数
+ *
+ * 计数保存在被共享的对象内部, 创建时为1. 增加引用只需 relaxed 原子加,
+ * 减少引用使用 release, 减到0的线程通过 acquire 栅栏看到其他持有者
+ * 之前的全部写入, 之后可以安全地释放对象.
+ */
 class Reference {
  public:
-  Reference() : reference_count_(new size_t(1)) {}
+  Reference() : reference_count_(1) {}
   Reference(const Reference &) = delete;
   Reference(const Reference &&) = delete;
 
+  /**
+   * @brief 减少引用
+   *
+   * @return size_t 减少后的引用数, 为0时调用方负责释放对象
+   */
   size_t DecrementReference() {
-    lock_guard<mutex> lock(reference_mutex_);
-    if (reference_count_ != nullptr) {
-      --(*reference_count_);
-      if (*reference_count_ == 0) {
-        delete reference_count_;
-        reference_count_ = nullptr;
-        return 0;
-      }
+    size_t count =
+        reference_count_.fetch_sub(1, std::memory_order_release) - 1;
+    if (count == 0) {
+      std::atomic_thread_fence(std::memory_order_acquire);
     }
-    return *reference_count_;
+    return count;
   }
 
+  /**
+   * @brief 增加引用, 调用方必须已经持有一个引用
+   *
+   * @return size_t 增加后的引用数
+   */
   size_t IncrementReference() {
-    lock_guard<mutex> lock(reference_mutex_);
-    return ++(*(this->reference_count_));
+    return reference_count_.fetch_add(1, std::memory_order_relaxed) + 1;
   }
 
-  size_t reference_count() {
-    lock_guard<mutex> lock(reference_mutex_);
-    if (reference_count_ == nullptr) {
-      return 0;
-    }
-    return *reference_count_;
+  size_t reference_count() const {
+    return reference_count_.load(std::memory_order_relaxed);
   }
 
- protected:
-  size_t *reference_count_;
-  mutex reference_mutex_;
+ private:
+  atomic<size_t> reference_count_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -16,6 +16,7 @@
 #include "file.h"
 #include "fmt/format.h"
 #include "io/TableSpaceDiskManager.h"
+#include "io/TableSpaceRegistry.h"
 #include "memory/buffer.h"
 #include "serialize.h"
 
@@ -39,11 +40,12 @@ struct Test {
 
 int main() {
   LRUBufferPool pool(10);
-  PagePosition p = {"data2.index", 0};
+  space_t space = TableSpaceRegistry::Instance()->Register("data2.index");
+  PagePosition p = {space, 0};
 
   auto test =
       BufferedObjectMakerManager::Instance()->Select(&pool)->NewObject<Test>(
-          PagePosition{"data2.index", 0}, 0, 1, 2);
+          PagePosition{space, 0}, 0, 1, 2);
 
   cout << test->a << endl;
   // test->a = 1;
@@ -6,49 +6,81 @@
 #include <cassert>
 #include <iostream>
 #include <queue>
+#include <shared_mutex>
 
 #include "bplustree/bplustree_page.h"
 #include "buffer/buffer_pool.h"
-#include "buffer/maker.h"
+#include "buffer/scan_ring.h"
 #include "io/SpaceManager.h"
 #include "io/TableSpaceDiskManager.h"
+#include "io/TableSpaceRegistry.h"
 #include "serialize.h"
 
 using std::cout;
 using std::endl;
 using std::queue;
+using std::shared_lock;
+using std::unique_lock;
 
 ostream &operator<<(ostream &os, const BPlusTreeIndexMeta &meta) {
   return os << "{"
-            << fmt::format("root={}, leaf={}, free={}, crc={}", meta.root,
-                           meta.leaf, meta.free, meta.crc)
+            << fmt::format("root={}, leaf={}, free={}, crc={}, page_size={}",
+                           meta.root, meta.leaf, meta.free, meta.crc,
+                           meta.page_size)
             << "}";
 }
 
 BPlusTreeIndex::BPlusTreeIndex(const string &index_file_path,
-                               const Compare &compare, IBufferPool *pool)
-    : index_file_path_(index_file_path), comparator_(compare), pool_(pool) {
-  maker_ = BufferedObjectMakerManager::Instance()->Select(pool_);
+                               const Compare &compare, IBufferPool *pool,
+                               size_t max_pinned_pages, uint32_t page_size)
+    : index_file_path_(index_file_path),
+      comparator_(compare),
+      pool_(pool),
+      upper_levels_stale_(true),
+      max_pinned_pages_(max_pinned_pages) {
   space_manager_ = TableSpaceDiskManager::Instance();
+  space_ = TableSpaceRegistry::Instance()->Register(index_file_path_);
 
   // 打开索引文件
   bool is_init = File::exist(index_file_path);
 
   // 加载索引的元数据
-  index_meta_ = new BPlusTreeIndexMeta{0, 0, 0, 0, 0};
+  index_meta_ = new BPlusTreeIndexMeta{0, 0, 0, 0, 0, 0};
   if (is_init) {
-    space_manager_->read(index_file_path_, 0,
+    space_manager_->read(space_, 0,
                          reinterpret_cast<char *>(index_meta_),
-                         sizeof(index_meta_));
+                         sizeof(BPlusTreeIndexMeta));
   }
+
+  // 页面大小在创建索引时确定, 之后以元数据中保存的为准
+  if (!is_init) {
+    if (!TableSpaceRegistry::ValidPageSize(page_size)) {
+      spdlog::warn("{}: invalid page_size={}, use {}", __func__, page_size,
+                   PAGE_SIZE);
+      page_size = PAGE_SIZE;
+    }
+    index_meta_->page_size = page_size;
+  } else if (!TableSpaceRegistry::ValidPageSize(index_meta_->page_size)) {
+    index_meta_->page_size = PAGE_SIZE;
+  }
+  page_size_ = index_meta_->page_size;
+  TableSpaceRegistry::Instance()->SetPageSize(space_, page_size_);
   spdlog::info("{}: index_meta={}", __func__, *index_meta_);
+
+  this->PinUpperLevels();
 }
 
 BPlusTreeIndex::~BPlusTreeIndex() {
   if (index_meta_ != nullptr) {
     spdlog::info("{}: index_meta={}", __func__, *index_meta_);
 
-    space_manager_->write(index_file_path_, 0,
+    // 页面由缓冲池负责写回, 关闭索引前需要将脏页落盘
+    {
+      unique_lock<shared_mutex> guard(pinned_lock_);
+      this->UnpinUpperLevels();
+    }
+    pool_->FlushAllPage();
+    space_manager_->write(space_, 0,
                           reinterpret_cast<char *>(index_meta_),
                           sizeof(BPlusTreeIndexMeta));
     delete index_meta_;
@@ -65,7 +97,14 @@ BPlusTreeIndex::~BPlusTreeIndex() {
  */
 ResultCode BPlusTreeIndex::Insert(string_view key, string_view val) {
   address_t leaf_node_address = this->LocateLeafNode(key);
-  return this->Insert(PageType::kLeafPage, leaf_node_address, key, {val});
+  // 树非空时地址为0表示缓冲池没有可用的帧, 不能当作空树新建根节点
+  if (leaf_node_address == 0 && index_meta_->root != 0) {
+    return ResultCode::FAIL;
+  }
+  ResultCode code =
+      this->Insert(PageType::kLeafPage, leaf_node_address, key, {val});
+  this->PinUpperLevels();
+  return code;
 }
 
 /**
@@ -76,7 +115,12 @@ ResultCode BPlusTreeIndex::Insert(string_view key, string_view val) {
  */
 ResultCode BPlusTreeIndex::Erase(string_view key) {
   address_t leaf_node_address = this->LocateLeafNode(key);
-  return this->Erase(PageType::kLeafPage, leaf_node_address, key);
+  if (leaf_node_address == 0) {
+    return ResultCode::FAIL;
+  }
+  ResultCode code = this->Erase(PageType::kLeafPage, leaf_node_address, key);
+  this->PinUpperLevels();
+  return code;
 }
 
 /**
@@ -86,210 +130,429 @@ ResultCode BPlusTreeIndex::Erase(string_view key) {
  * @return optional<address_t>
  */
 optional<string> BPlusTreeIndex::Search(string_view key) {
-  address_t leaf_node_address = this->LocateLeafNode(key);
-  Page page(kLeafPage);
-  file_->read(leaf_node_address, page.base_address(), PAGE_SIZE);
+  LeafSearch search;
+  address_t leaf_node_address = this->LocateLeafNode(key, &search);
+  if (leaf_node_address == 0) {
+    return std::nullopt;
+  }
+  if (search.done) {
+    return std::move(search.value);
+  }
+  auto guard = this->ReadPage(leaf_node_address);
+  if (!guard.valid()) {
+    return std::nullopt;
+  }
+  const Page page = Page::ReadOnly(kLeafPage, guard.data());
   return page.Search(key, comparator_);
 }
 
 /**
  * @brief 根据键值定位叶子节点的地址
  *
+ * 根节点与第二层内部页常驻在缓冲池中, 点查只需要从缓冲池获取叶子页.
+ * 页面优先乐观读取, 与写者冲突或不在缓冲池中时再固定页面读取.
+ * 只读取常驻页面的集合, 不修改它
+ *
  * @param key 键
- * @param comparator_ 比较器
- * @return address_t 叶子节点地址
+ * @param search 不为 nullptr 时, 乐观读取到叶子页后在其中查找键
+ * @return address_t 叶子节点地址, 空树或缓冲池没有可用的帧时为0
  */
-address_t BPlusTreeIndex::LocateLeafNode(string_view key) {
+address_t BPlusTreeIndex::LocateLeafNode(string_view key, LeafSearch *search) {
   if (index_meta_->root == 0) {
     return 0;
   }
 
-  // Page page(PageType::kLeafPage);
-  // file_->read(index_meta_->root, page.base_address(), PAGE_SIZE);
+  address_t target_node_address = index_meta_->root;
+  while (true) {
+    address_t child_address;
+    if (this->ReadNodeOptimistic(target_node_address, key, &child_address,
+                                 search)) {
+      if (child_address == 0) {
+        return target_node_address;
+      }
+      target_node_address = child_address;
+      continue;
+    }
+
+    {
+      // 持有共享锁期间常驻页面不会被解除固定, 只需再持有帧的读锁
+      shared_lock<shared_mutex> pinned_guard(pinned_lock_);
+      auto iter = pinned_frames_.find(target_node_address);
+      if (iter != pinned_frames_.end()) {
+        shared_lock<shared_mutex> latch(iter->second->latch);
+        const Page page = Page::ReadOnly(kInternalPage, iter->second->buffer);
+        if (page.meta()->page_type == PageType::kLeafPage) {
+          return target_node_address;
+        }
+        target_node_address = this->LocateChild(page, key);
+        continue;
+      }
+    }
 
-  auto page =
-      maker_->NewObject<Page>(PagePosition{index_file_path_, index_meta_->root},
-                              PageType::kLeafPage, true);
+    auto guard = this->ReadPage(target_node_address);
+    if (!guard.valid()) {
+      return 0;
+    }
+    const Page page = Page::ReadOnly(kInternalPage, guard.data());
+    if (page.meta()->page_type == PageType::kLeafPage) {
+      return target_node_address;
+    }
+    target_node_address = this->LocateChild(page, key);
+  }
+}
 
-  address_t target_node_address = index_meta_->root;
-  // while (page->meta()->page_type == PageType::kInternalPage) {
-  //   uint16_t offset = page->LowerBound(key, comparator_);
-  //   auto meta = page->UnmodifiedAttribute<RecordMeta>(offset);
-  //   target_node_address = *(page->get_arribute<address_t>(
-  //       offset + sizeof(RecordMeta) + meta->key_len));
-  //   page = maker_->NewObject<Page>(
-  //       PagePosition{index_file_path_, target_node_address},
-  //       PageType::kLeafPage, true);
-  // }
-
-  return target_node_address;
+/**
+ * @brief 在内部页中定位键所在的孩子节点
+ *
+ * @param page 内部页
+ * @param key 键
+ * @return address_t 孩子节点地址
+ */
+address_t BPlusTreeIndex::LocateChild(const Page &page, string_view key) {
+  uint16_t offset = page.UnmodifiedLowerBound(key, comparator_);
+  string_view child_address = page.Value(offset);
+  return Serializer<address_t>::deserialize(
+      {child_address.data(), child_address.length()});
 }
 
-ResultCode BPlusTreeIndex::Insert(PageType page_type, address_t page_address,
-                                  string_view key,
-                                  const vector<string_view> &vals) {
-  Page page = Page(page_type);
-  if (page_address != 0) {
-    file_->read(page_address, page.base_address(), PAGE_SIZE);
-  } else {
-    index_meta_->root =
-        BPLUSTREE_INDEX_PAGE_ADDRESS(index_meta_->max_page_id++);
-    page.meta()->self = index_meta_->root;
-    if (page_type == kLeafPage) {
-      index_meta_->leaf = index_meta_->root;
+/**
+ * @brief 常驻根节点和第二层内部页
+ *
+ * 树结构发生变化时(根节点变化或根节点的孩子变化), 写操作结束后重新
+ * 固定上层页面. 乐观读取不受影响, 读取常驻页面的读者等待重新固定完成
+ */
+void BPlusTreeIndex::PinUpperLevels() {
+  if (!upper_levels_stale_ || index_meta_->root == 0) {
+    return;
+  }
+  unique_lock<shared_mutex> guard(pinned_lock_);
+  this->UnpinUpperLevels();
+
+  // 常驻页面不能占满缓冲池, 否则其他页面没有可用的帧
+  size_t max_pinned_pages =
+      std::min(max_pinned_pages_,
+               pool_->MaxPinnedPages(space_) / PINNED_PAGES_FRACTION);
+  if (max_pinned_pages == 0) {
+    upper_levels_stale_ = false;
+    return;
+  }
+
+  Frame *root = pool_->FetchPage({space_, index_meta_->root});
+  if (root == nullptr) {
+    // 下次写操作结束时重试
+    return;
+  }
+  upper_levels_stale_ = false;
+  pinned_frames_[index_meta_->root] = root;
+
+  shared_lock<shared_mutex> root_latch(root->latch);
+  Page root_page(kInternalPage, true, root->buffer);
+  if (root_page.meta()->page_type != PageType::kInternalPage) {
+    return;
+  }
+
+  // 跳过虚拟最小记录, 其余记录(包括虚拟最大记录)的值为孩子节点地址
+  auto iter = root_page.Iterator().Next();
+  while (!iter.isEnd() && pinned_frames_.size() < max_pinned_pages) {
+    address_t child_address = Serializer<address_t>::deserialize(
+        {iter->val.data(), iter->val.length()});
+    iter = iter.Next();
+    if (child_address == 0 || pinned_frames_.count(child_address)) {
+      continue;
+    }
+
+    Frame *child = pool_->FetchPage({space_, child_address});
+    if (child == nullptr) {
+      break;
     }
+    bool is_internal;
+    {
+      shared_lock<shared_mutex> child_latch(child->latch);
+      Page child_page(kInternalPage, true, child->buffer);
+      is_internal = child_page.meta()->page_type == PageType::kInternalPage;
+    }
+    // 叶子页不常驻, 避免占满缓冲池
+    if (!is_internal) {
+      pool_->UnPinPage({space_, child_address});
+      continue;
+    }
+    pinned_frames_[child_address] = child;
   }
+}
 
-  ResultCode code = page.Insert(key, vals, comparator_);
+/**
+ * @brief 释放常驻的上层页面
+ *
+ */
+void BPlusTreeIndex::UnpinUpperLevels() {
+  for (auto &[page_address, frame] : pinned_frames_) {
+    pool_->UnPinPage({space_, page_address});
+  }
+  pinned_frames_.clear();
+}
 
-  // if (page_type == kInternalPage) {
-  //   cout << "Internal" << endl;
-  //   page.scan_use();
-  // }
+/**
+ * @brief 从缓冲池中获取页面并持有读锁
+ *
+ * @param page_address 页面地址
+ * @return ReadPageGuard
+ */
+ReadPageGuard BPlusTreeIndex::ReadPage(address_t page_address) {
+  return {pool_, PagePosition{space_, page_address}};
+}
 
-  if (ResultCode::ERROR_PAGE_FULL == code) {
-    // // page.scan_use();
-    // cout << "SplitPage:" << key << endl;
-    // if (key == "key1010") {
-    //   cout << "debug" << endl;
-    // }
-    // page.scan_use();
-    // page.scan_slots();
-    auto [mid_key, other_page] = page.SplitPage();
+/**
+ * @brief 乐观读取节点, 直接在帧上查找, 不复制页面
+ *
+ * 读取函数可能被调用多次, 结果先记录在局部变量中, 缓冲池核对版本号后
+ * 才返回给调用方
+ *
+ * @param page_address 页面地址
+ * @param key 键
+ * @param child 内部页中键所在的孩子节点地址, 叶子页为0
+ * @param search 不为 nullptr 时在叶子页中查找键
+ * @return true 读取成功
+ * @return false 页面不在缓冲池中或与写者冲突
+ */
+bool BPlusTreeIndex::ReadNodeOptimistic(address_t page_address,
+                                        string_view key, address_t *child,
+                                        LeafSearch *search) {
+  // 读取函数只捕获一个指针, 构造 OptimisticReader 时不分配内存
+  struct Step {
+    BPlusTreeIndex *index;
+    string_view key;
+    bool want_value;
+    bool is_leaf;
+    address_t child;
+    optional<string> value;
+  } step{this, key, search != nullptr, false, 0, std::nullopt};
+
+  bool read = pool_->ReadPageOptimistic(
+      {space_, page_address}, [&step](const char *data) {
+        const Page page = Page::ReadOnly(kInternalPage, data);
+        uint16_t page_type = page.meta()->page_type;
+        if (page_type != kLeafPage && page_type != kInternalPage) {
+          return false;
+        }
+        step.is_leaf = page_type == kLeafPage;
+        if (step.is_leaf && !step.want_value) {
+          return true;
+        }
 
-    // cout << "Insert:mid_key=" << mid_key << ",key=" << key << endl;
-    // other_page.scan_use();
-    // other_page.scan_slots();
+        RecordData record;
+        if (!page.OptimisticLowerBound(step.index->page_size_, step.key,
+                                       step.index->comparator_, &record)) {
+          return false;
+        }
+        if (step.is_leaf) {
+          step.value.reset();
+          if (step.index->comparator_(step.key, record.key) == 0) {
+            step.value.emplace(record.val);
+          }
+          return true;
+        }
+        if (record.val.size() != sizeof(address_t)) {
+          return false;
+        }
+        step.child = Serializer<address_t>::deserialize(
+            {record.val.data(), record.val.length()});
+        return step.child != 0;
+      });
+  if (!read) {
+    return false;
+  }
 
-    if (key < mid_key) {
-      if (ResultCode::SUCCESS != page.Insert(key, vals, comparator_)) {
-        return ResultCode::FAIL;
-      }
+  *child = step.is_leaf ? 0 : step.child;
+  if (step.is_leaf && search != nullptr) {
+    search->done = true;
+    search->value = std::move(step.value);
+  }
+  return true;
+}
 
-    } else {
-      if (ResultCode::SUCCESS != other_page.Insert(key, vals, comparator_)) {
-        return ResultCode::FAIL;
-      }
-    }
-    // cout << "Insert Mid" << endl;
+/**
+ * @brief 从缓冲池中获取页面并持有写锁, 释放时页面标记为脏页
+ *
+ * @param page_address 页面地址
+ * @param is_new 是否为新分配的页面, 新页面不从磁盘读取
+ * @return WritePageGuard
+ */
+WritePageGuard BPlusTreeIndex::WritePage(address_t page_address,
+                                         bool is_new) {
+  return {pool_, PagePosition{space_, page_address}, is_new};
+}
 
-    other_page.meta()->self =
-        BPLUSTREE_INDEX_PAGE_ADDRESS(index_meta_->max_page_id++);
-    page.meta()->next = other_page.meta()->self;
+ResultCode BPlusTreeIndex::Insert(PageType page_type, address_t page_address,
+                                  string_view key,
+                                  const vector<string_view> &vals) {
+  bool is_new_page = page_address == 0;
+  // 根节点新增孩子或产生新的根节点时, 常驻的上层页面需要重新固定
+  if (is_new_page || page_address == index_meta_->root) {
+    upper_levels_stale_ = true;
+  }
+  if (is_new_page) {
+    page_address =
+        BPLUSTREE_INDEX_PAGE_ADDRESS(index_meta_->max_page_id, page_size_);
+  }
 
-    string left_child_address =
-        Serializer<address_t>::serialize(page.meta()->self);
-    string right_child_address =
-        Serializer<address_t>::serialize(other_page.meta()->self);
+  string mid_key;
+  string left_child_address;
+  string right_child_address;
+  address_t parent_address;
 
-    address_t parent_address = page.meta()->parent;
-    if (page.meta()->parent == 0) {
-      address_t alloc_parent_address =
-          BPLUSTREE_INDEX_PAGE_ADDRESS(index_meta_->max_page_id);
-      page.meta()->parent = alloc_parent_address;
-      other_page.meta()->parent = alloc_parent_address;
-    } else {
-      other_page.meta()->parent = parent_address;
+  {
+    // 新页面在帧上初始化
+    auto guard = this->WritePage(page_address, is_new_page);
+    if (!guard.valid()) {
+      return ResultCode::FAIL;
+    }
+    Page page(page_type, !is_new_page, guard.data(), page_size_);
+    if (is_new_page) {
+      index_meta_->max_page_id++;
+      index_meta_->root = page_address;
+      if (page_type == kLeafPage) {
+        index_meta_->leaf = page_address;
+      }
+      page.meta()->self = page_address;
     }
 
-    file_->write(page.meta()->self, page.base_address(), PAGE_SIZE);
-    file_->write(other_page.meta()->self, other_page.base_address(), PAGE_SIZE);
+    ResultCode code = page.Insert(key, vals, comparator_);
+    if (ResultCode::ERROR_PAGE_FULL != code) {
+      return code;
+    }
 
-    if (page_type == kInternalPage) {
-      this->ModifyParentAddressOfChildren(other_page);
+    // 在页面副本上分裂和插入, 成功后再写回帧, 失败时帧上的页面保持不变
+    Page left(page_type, true, nullptr, page_size_);
+    memcpy(left.base_address(), guard.data(), page_size_);
+    auto [split_key, right] = left.SplitPage();
+    mid_key = std::move(split_key);
+
+    Page &target = key < mid_key ? left : right;
+    if (ResultCode::SUCCESS != target.Insert(key, vals, comparator_)) {
+      return ResultCode::FAIL;
     }
 
-    // page.scan_use();
-    // page.scan_slots();
-    // other_page.scan_use();
-    // other_page.scan_slots();
-    return this->Insert(PageType::kInternalPage, parent_address, mid_key,
-                        {left_child_address, right_child_address});
+    address_t right_address =
+        BPLUSTREE_INDEX_PAGE_ADDRESS(index_meta_->max_page_id, page_size_);
+    auto right_guard = this->WritePage(right_address, true);
+    if (!right_guard.valid()) {
+      return ResultCode::FAIL;
+    }
+    index_meta_->max_page_id++;
+    right.meta()->self = right_address;
+    left.meta()->next = right_address;
 
-    // file_->read(page.meta()->self, )
+    left_child_address = Serializer<address_t>::serialize(left.meta()->self);
+    right_child_address = Serializer<address_t>::serialize(right_address);
 
-    // Page parent(kInternalPage);
-    // file_->read(page.meta()->parent, parent.base_address(), PAGE_SIZE);
-    // uint16_t parent_key_offset = parent.LowerBound(mid_key, comparator_);
-    // page.meta()->parent_key_offset = parent_key_offset;
-    // other_page.meta()->parent_key_offset =
-    //     parent.get_arribute<RecordMeta>(parent_key_offset)->next;
+    parent_address = left.meta()->parent;
+    if (parent_address == 0) {
+      address_t alloc_parent_address =
+          BPLUSTREE_INDEX_PAGE_ADDRESS(index_meta_->max_page_id, page_size_);
+      left.meta()->parent = alloc_parent_address;
+      right.meta()->parent = alloc_parent_address;
+    } else {
+      right.meta()->parent = parent_address;
+    }
 
-    // file_->write(other_page.meta()->self, other_page.base_address(),
-    // PAGE_SIZE);
+    // 分裂结果拷贝到缓冲帧中, 由缓冲池负责写回
+    memcpy(guard.data(), left.base_address(), page_size_);
+    memcpy(right_guard.data(), right.base_address(), page_size_);
 
-    // return code;
-    // return ResultCode::NODE_FULL;
+    if (page_type == kInternalPage) {
+      this->ModifyParentAddressOfChildren(right);
+    }
   }
 
-  file_->write(page.meta()->self, page.base_address(), PAGE_SIZE);
-  return code;
-  // return ResultCode::SUCCESS;
+  return this->Insert(PageType::kInternalPage, parent_address, mid_key,
+                      {left_child_address, right_child_address});
 }
 
 ResultCode BPlusTreeIndex::Erase(PageType page_type, address_t page_address,
                                  string_view key) {
-  Page page(page_type);
-  file_->read(page_address, page.base_address(), PAGE_SIZE);
-
-  // 检查是否有节点被删除
-  if (ResultCode::ERROR_KEY_NOT_EXIST == page.Erase(key, comparator_)) {
-    // page.scan_use();
-    cout << "key_not_exist" << endl;
-    return ResultCode::ERROR_KEY_NOT_EXIST;
-  }
-
-  // 如果有节点被删除, 需要考虑页节点过少情况, 页合并的问题
-
-  auto meta = page.meta();
-  // 如果根节点为空, 则将根节点往下移动
-  if (index_meta_->root == meta->self && meta->node_size == 0) {
-    // 更新根节点, 修改子节点的父节点地址
-    string_view child_address = page.Value(page.virtual_max_record_address_);
-    index_meta_->root = Serializer<address_t>::deserialize(
-        {child_address.data(), child_address.length()});
-    Page child(kLeafPage);
-    file_->read(index_meta_->root, child.base_address(), PAGE_SIZE);
-    child.meta()->parent = 0;
-    file_->write(index_meta_->root, child.base_address(), PAGE_SIZE);
-    return ResultCode::SUCCESS;
-  }
-
-  file_->write(meta->self, page.base_address(), PAGE_SIZE);
-
-  if (meta->node_size == 0) {
-    // page.scan_use();
-    Page parent(kInternalPage);
-    file_->read(meta->parent, parent.base_address(), PAGE_SIZE);
-    auto parent_need_erase_key =
-        parent.Key(parent.LowerBound(key, comparator_));
-    return this->Erase(PageType::kInternalPage, meta->parent,
-                       parent_need_erase_key);
-  }
+  address_t parent_address;
+  string parent_need_erase_key;
+  address_t prev_address;
+  address_t next_address;
 
-  // 页合并的下限
-  uint16_t data_size =
-      meta->size - Page::VIRTUAL_MIN_RECORD_SIZE - sizeof(PageMeta);
+  if (page_address == index_meta_->root) {
+    upper_levels_stale_ = true;
+  }
 
-  // cout << "free_size=" << meta->free_size << ",data_size=" << data_size
-  //      << ",factor=" << (meta->free_size * 1.0 / data_size) << endl;
-  if (meta->free_size * 1.0 / data_size >= 0.8) {
-    Page sibling_page(page_type);
-    Page parent(kInternalPage);
+  {
+    auto guard = this->WritePage(page_address);
+    if (!guard.valid()) {
+      return ResultCode::FAIL;
+    }
+    Page page(page_type, true, guard.data());
 
-    ResultCode code = ResultCode::SUCCESS;
+    // 检查是否有节点被删除
+    if (ResultCode::ERROR_KEY_NOT_EXIST == page.Erase(key, comparator_)) {
+      spdlog::debug("{}: key not exist in page={}", __func__, page_address);
+      return ResultCode::ERROR_KEY_NOT_EXIST;
+    }
 
-    if (meta->next != 0) {
-      code = EraseParentAndMergeSibling(page_type, page_address, meta->next);
+    // 如果有节点被删除, 需要考虑页节点过少情况, 页合并的问题
+
+    auto meta = page.meta();
+    // 如果根节点为空, 则将根节点往下移动
+    if (index_meta_->root == meta->self && meta->node_size == 0) {
+      // 更新根节点, 修改子节点的父节点地址
+      string_view child_address =
+          page.Value(page.virtual_max_record_address_);
+      index_meta_->root = Serializer<address_t>::deserialize(
+          {child_address.data(), child_address.length()});
+      auto child_guard = this->WritePage(index_meta_->root);
+      if (!child_guard.valid()) {
+        return ResultCode::FAIL;
+      }
+      Page child(kLeafPage, true, child_guard.data());
+      child.meta()->parent = 0;
+      return ResultCode::SUCCESS;
     }
 
-    if (ResultCode::ERROR_NOT_MATCH_CONSTRAINT == code && meta->prev != 0) {
-      code = EraseParentAndMergeSibling(page_type, meta->prev, page_address);
+    if (meta->node_size == 0) {
+      // 释放本页的写锁后再读父页, 与自上而下的加锁顺序一致
+      parent_address = meta->parent;
+    } else {
+      // 页合并的下限
+      uint16_t data_size =
+          meta->size - Page::VIRTUAL_MIN_RECORD_SIZE - sizeof(PageMeta);
+      if (meta->free_size * 1.0 / data_size < 0.8) {
+        return ResultCode::SUCCESS;
+      }
+      parent_address = 0;
+      prev_address = meta->prev;
+      next_address = meta->next;
     }
+  }
 
-    if (ResultCode::ERROR_NOT_MATCH_CONSTRAINT != code) {
-      return code;
+  if (parent_address != 0) {
+    {
+      auto parent_guard = this->ReadPage(parent_address);
+      if (!parent_guard.valid()) {
+        return ResultCode::FAIL;
+      }
+      const Page parent = Page::ReadOnly(kInternalPage, parent_guard.data());
+      parent_need_erase_key =
+          parent.Key(parent.UnmodifiedLowerBound(key, comparator_));
     }
+    return this->Erase(PageType::kInternalPage, parent_address,
+                       parent_need_erase_key);
+  }
+
+  ResultCode code = ResultCode::ERROR_NOT_MATCH_CONSTRAINT;
+
+  if (next_address != 0) {
+    code = EraseParentAndMergeSibling(page_type, page_address, next_address);
+  }
+
+  if (ResultCode::ERROR_NOT_MATCH_CONSTRAINT == code && prev_address != 0) {
+    code = EraseParentAndMergeSibling(page_type, prev_address, page_address);
+  }
+
+  if (ResultCode::ERROR_NOT_MATCH_CONSTRAINT != code) {
+    return code;
   }
   return ResultCode::SUCCESS;
 }
@@ -297,38 +560,67 @@ ResultCode BPlusTreeIndex::Erase(PageType page_type, address_t page_address,
 ResultCode BPlusTreeIndex::EraseParentAndMergeSibling(
     PageType page_type, address_t left_child_address,
     address_t right_child_address) {
-  Page left_child(page_type), right_child(page_type), parent(kInternalPage);
-  file_->read(left_child_address, left_child.base_address(), PAGE_SIZE);
-  file_->read(right_child_address, right_child.base_address(), PAGE_SIZE);
+  address_t parent_address;
+  string parent_key;
 
-  if (left_child.meta()->free_size < right_child.ValidDataSize()) {
-    return ResultCode::ERROR_NOT_MATCH_CONSTRAINT;
+  {
+    auto guard = this->ReadPage(left_child_address);
+    if (!guard.valid()) {
+      return ResultCode::FAIL;
+    }
+    parent_address = Page::ReadOnly(page_type, guard.data()).meta()->parent;
   }
-
-  if (left_child.meta()->parent != right_child.meta()->parent) {
+  if (parent_address == 0) {
     return ResultCode::ERROR_NOT_MATCH_CONSTRAINT;
   }
 
-  file_->read(left_child.meta()->parent, parent.base_address(), PAGE_SIZE);
+  {
+    // 按父页, 左页, 右页的顺序加写锁, 与自上而下, 从左到右的读取顺序一致.
+    // 检查和合并期间一直持有三个页面的写锁, 合并结果基于最新的页面
+    auto parent_guard = this->WritePage(parent_address);
+    auto left_guard = this->WritePage(left_child_address);
+    auto right_guard = this->WritePage(right_child_address);
+    if (!parent_guard.valid() || !left_guard.valid() || !right_guard.valid()) {
+      return ResultCode::FAIL;
+    }
+    Page parent(kInternalPage, true, parent_guard.data());
+    Page left_child(page_type, true, left_guard.data());
+    Page right_child(page_type, true, right_guard.data());
 
-  auto last_key_iter = left_child.GetLastIterator();
+    if (left_child.meta()->free_size < right_child.ValidDataSize()) {
+      return ResultCode::ERROR_NOT_MATCH_CONSTRAINT;
+    }
 
-  auto parent_key_address = parent.LowerBound(last_key_iter->key, comparator_);
+    if (left_child.meta()->parent != parent_address ||
+        right_child.meta()->parent != parent_address) {
+      return ResultCode::ERROR_NOT_MATCH_CONSTRAINT;
+    }
 
-  auto parent_key = parent.Key(parent_key_address);
+    // 合并结果写入右页所在的位置, 左页保持不变. 右页同时是合并的输入,
+    // 先在左页的副本上追加, 再拷贝到右页的帧上
+    Page merged(page_type, true, nullptr, page_size_);
+    memcpy(merged.base_address(), left_guard.data(), page_size_);
 
-  if (PageType::kInternalPage == page_type) {
-    left_child.Append(parent_key, last_key_iter->val, comparator_);
-  }
+    auto last_key_iter = merged.GetLastIterator();
 
-  left_child.AppendPage(right_child, comparator_);
+    auto parent_key_address =
+        parent.UnmodifiedLowerBound(last_key_iter->key, comparator_);
 
-  left_child.meta()->self = right_child.meta()->self;
-  left_child.meta()->next = right_child.meta()->next;
+    parent_key = parent.Key(parent_key_address);
 
-  file_->write(left_child.meta()->self, left_child.base_address(), PAGE_SIZE);
-  return this->Erase(PageType::kInternalPage, left_child.meta()->parent,
-                     parent_key);
+    if (PageType::kInternalPage == page_type) {
+      merged.Append(parent_key, last_key_iter->val, comparator_);
+    }
+
+    merged.AppendPage(right_child, comparator_);
+
+    merged.meta()->self = right_child.meta()->self;
+    merged.meta()->next = right_child.meta()->next;
+
+    memcpy(right_guard.data(), merged.base_address(), page_size_);
+  }
+
+  return this->Erase(PageType::kInternalPage, parent_address, parent_key);
 }
 
 /**
@@ -339,29 +631,42 @@ ResultCode BPlusTreeIndex::EraseParentAndMergeSibling(
 void BPlusTreeIndex::ModifyParentAddressOfChildren(Page &page) {
   uint16_t record_address =
       page.get_arribute<RecordMeta>(page.meta()->use)->next;
-  Page child_page(kLeafPage);
-  cout << "ModifyParentAddressOfChildren:";
   while (record_address != 0) {
     auto record_meta = page.get_arribute<RecordMeta>(record_address);
     address_t child_address = *(page.get_arribute<address_t>(
         record_address + sizeof(RecordMeta) + record_meta->key_len));
-    cout << "(" << child_address << "," << page.meta()->self << ")";
-    file_->read(child_address, child_page.base_address(), PAGE_SIZE);
-    child_page.meta()->parent = page.meta()->self;
-    file_->write(child_address, child_page.base_address(), PAGE_SIZE);
+    spdlog::debug("{}: child={} parent={}", __func__, child_address,
+                  page.meta()->self);
+    auto child_guard = this->WritePage(child_address);
     record_address = record_meta->next;
+    if (!child_guard.valid()) {
+      spdlog::error("{}: failed to fetch child={}", __func__, child_address);
+      continue;
+    }
+    Page child_page(kLeafPage, true, child_guard.data());
+    child_page.meta()->parent = page.meta()->self;
   }
-  cout << endl;
   return;
 }
 
 void BPlusTreeIndex::ScanLeafPage() {
+  // 叶子页在私有的扫描环中轮换, 全量扫描不淘汰点查的热点页面
+  ScanRing ring(pool_);
   address_t leaf_node_address = index_meta_->leaf;
   while (leaf_node_address) {
-    Page page(kLeafPage);
-    file_->read(leaf_node_address, page.base_address(), PAGE_SIZE);
+    ReadPageGuard guard(pool_, {space_, leaf_node_address}, &ring);
+    if (!guard.valid()) {
+      spdlog::error("{}: failed to fetch leaf={}", __func__,
+                    leaf_node_address);
+      break;
+    }
+    const Page page = Page::ReadOnly(kLeafPage, guard.data());
     leaf_node_address = page.meta()->next;
-    cout << "leaf_node_address=" << leaf_node_address << endl;
+    // 扫描当前叶子页时预读下一个叶子页
+    if (leaf_node_address != 0) {
+      pool_->Prefetch({space_, leaf_node_address}, &ring);
+    }
+    spdlog::debug("{}: next leaf={}", __func__, leaf_node_address);
     page.scan_use();
   }
 }
@@ -376,23 +681,27 @@ void BPlusTreeIndex::BFS() {
       for (int j = 0; j < d; j++) {
         cout << "\t";
       }
-      Page page(kInternalPage);
-      file_->read(q.front(), page.base_address(), PAGE_SIZE);
+      auto guard = this->ReadPage(q.front());
       q.pop();
-      auto use = page.get_arribute<RecordMeta>(page.meta()->use);
+      if (!guard.valid()) {
+        continue;
+      }
+      const Page page = Page::ReadOnly(kInternalPage, guard.data());
+      auto use = page.UnmodifiedAttribute<RecordMeta>(page.meta()->use);
       uint16_t offset = page.meta()->use;
       cout << "Page[meta=" << *page.meta();
       while (use) {
         string_view key = {page.base_address() + sizeof(RecordMeta) + offset,
                            static_cast<size_t>(use->key_len)};
         if (page.meta()->page_type == kLeafPage) {
-          string_view val = {
-              page.base_address() + sizeof(RecordMeta) + offset + use->key_len,
-              static_cast<size_t>(use->val_len)};
+          string_view val = {page.base_address() + sizeof(RecordMeta) +
+                                 offset + use->key_len,
+                             static_cast<size_t>(use->val_len)};
           cout << "(" << key << ", " << val << ")";
         } else {
           address_t val = *reinterpret_cast<address_t *>(
-              page.base_address() + sizeof(RecordMeta) + offset + use->key_len);
+              page.base_address() + sizeof(RecordMeta) + offset +
+              use->key_len);
           cout << "(" << key;
           if (key != "min") {
             cout << ", " << val;
@@ -404,10 +713,10 @@ void BPlusTreeIndex::BFS() {
         }
 
         offset = use->next;
-        use = page.get_arribute<RecordMeta>(use->next);
+        use = page.UnmodifiedAttribute<RecordMeta>(use->next);
       }
       cout << "]" << endl;
     }
     d++;
   }
-}
\ No newline at end of file
+}
@@ -11,6 +11,7 @@
 
 #include "basetype.h"
 #include "bplustree/record.h"
+#include "memory/allocator.h"
 #include "serialize.h"
 
 using std::cout;
@@ -43,10 +44,13 @@ ostream &operator<<(ostream &os, const PageMeta &meta) {
 uint16_t Page::VIRTUAL_MIN_RECORD_SIZE =
     sizeof(RecordMeta) + 3 + sizeof(RecordMeta) + 3 + 8;
 
-Page::Page(PageType page_type, bool isLoad, char *buffer) {
+Page::Page(PageType page_type, bool isLoad, char *buffer, uint32_t page_size) {
   base_address_ = buffer;
   if (base_address_ == nullptr) {
-    page_data_guard_.reset(new char[PAGE_SIZE]);
+    page_data_guard_.reset(PageBufferAllocator::Alloc(page_size),
+                           [page_size](char *buffer) {
+                             PageBufferAllocator::Dealloc(buffer, page_size);
+                           });
     base_address_ = page_data_guard_.get();
   }
 
@@ -65,7 +69,7 @@ Page::Page(PageType page_type, bool isLoad, char *buffer) {
   }
   // 设置基本属性
   meta_->slots = 2;
-  meta_->size = PAGE_SIZE;
+  meta_->size = page_size;
   meta_->use = sizeof(PageMeta);
   meta_->page_type = page_type;
   meta_->parent_key_offset = 0;
@@ -108,6 +112,11 @@ Page::Page(PageType page_type, bool isLoad, char *buffer) {
       meta_->size - meta_->heap_top - meta_->slots * sizeof(uint16_t);
 }
 
+const Page Page::ReadOnly(PageType page_type, const char *buffer) {
+  // 只读页面只暴露 const 方法, 不会写入页面数据
+  return Page(page_type, true, const_cast<char *>(buffer));
+}
+
 /**
  * @brief 插入记录
  *
@@ -435,7 +444,8 @@ pair<string, Page> Page::SplitPage() {
       owned + 1;
 
   size_t slot_size = sizeof(uint16_t) * (rest_slots - 1);
-  uint16_t *page_slots = new uint16_t[meta_->slots];
+  char *slots_buffer = PageBufferAllocator::Alloc(meta_->size);
+  uint16_t *page_slots = reinterpret_cast<uint16_t *>(slots_buffer);
   memcpy(page_slots, base_address_ + this->slot_offset(0), slot_size);
   meta_->slots = rest_slots;
   meta_->node_size = half + (meta_->page_type == PageType::kLeafPage);
@@ -449,7 +459,7 @@ pair<string, Page> Page::SplitPage() {
   // Page page = this->CopyRecordToNewPage(, new_page_begin_record_address);
   this->TidyPage();
 
-  delete[] page_slots;
+  PageBufferAllocator::Dealloc(slots_buffer, meta_->size);
   return {{mid_key.data(), mid_key.size()}, page};
 }
 
@@ -740,9 +750,10 @@ int Page::set_record(uint16_t offset, const RecordMeta *meta,
 }
 
 void Page::TidyPage() {
-  // todo 优化
-  char *buffer = new char[16 * 1024];
-  uint16_t *slots = new uint16_t[meta_->slots - 2];
+  // 记录和目录槽的临时缓冲区都不超过页面大小
+  char *buffer = PageBufferAllocator::Alloc(meta_->size);
+  char *slots_buffer = PageBufferAllocator::Alloc(meta_->size);
+  uint16_t *slots = reinterpret_cast<uint16_t *>(slots_buffer);
   uint16_t use = meta_->use;
   uint16_t offset = 0;
   uint16_t slot = 0;
@@ -783,8 +794,8 @@ void Page::TidyPage() {
 
   meta_->heap_top += offset;
   meta_->free_size = this->slot_offset(0) - meta_->heap_top;
-  delete[] buffer;
-  delete[] slots;
+  PageBufferAllocator::Dealloc(buffer, meta_->size);
+  PageBufferAllocator::Dealloc(slots_buffer, meta_->size);
 }
 
 /**
@@ -796,9 +807,11 @@ void Page::TidyPage() {
  */
 Page Page::CopyRecordToNewPage(uint16_t begin_record_address,
                                uint16_t end_record_address) {
-  Page page(static_cast<PageType>(meta_->page_type));
+  Page page(static_cast<PageType>(meta_->page_type), false, nullptr,
+            meta_->size);
 
-  uint16_t *page_slots = new uint16_t[meta_->slots];
+  char *slots_buffer = PageBufferAllocator::Alloc(meta_->size);
+  uint16_t *page_slots = reinterpret_cast<uint16_t *>(slots_buffer);
   page_slots[0] = sizeof(PageMeta);
   uint16_t new_page_slot_no = 1;
   uint16_t owned = 0;
@@ -863,6 +876,7 @@ Page Page::CopyRecordToNewPage(uint16_t begin_record_address,
   memcpy(page.base_address_ + page.slot_offset(0), page_slots,
          sizeof(uint16_t) * page.meta_->slots);
   page.meta_->free_size = page.slot_offset(0) - page.meta_->heap_top;
+  PageBufferAllocator::Dealloc(slots_buffer, meta_->size);
   return page;
 }
 
@@ -895,6 +909,103 @@ uint16_t Page::LowerBound(string_view key, const Compare &compare) noexcept {
   return prev->next;
 }
 
+/**
+ * @brief 大于等于目标key的, 最小key, 不修改页面
+ *
+ * @param key 键值
+ * @param compare 比较器
+ * @return uint16_t 记录地址
+ */
+uint16_t Page::UnmodifiedLowerBound(string_view key,
+                                    const Compare &compare) const noexcept {
+  uint16_t hit_slot = this->LocateSlot(key, compare);
+  uint16_t pre_address = this->SlotValue(hit_slot - 1);
+  auto prev = this->UnmodifiedAttribute<RecordMeta>(pre_address);
+  while (prev) {
+    auto cur = this->UnmodifiedAttribute<RecordMeta>(prev->next);
+    string_view data = {base_address_ + prev->next + sizeof(RecordMeta),
+                        static_cast<size_t>(cur->key_len)};
+    if (cur->owned || compare(key, data) >= 0) {
+      break;
+    }
+    prev = cur;
+  }
+  return prev->next;
+}
+
+bool Page::OptimisticLowerBound(uint32_t page_size, string_view key,
+                                const Compare &compare,
+                                RecordData *record) const noexcept {
+  // 元数据只读一次, 之后按读到的值核对边界
+  uint32_t size = meta_->size;
+  uint16_t slots = meta_->slots;
+  if (size != page_size || slots < 2 ||
+      sizeof(PageMeta) + slots * sizeof(uint16_t) > size) {
+    return false;
+  }
+  const char *slot_base = base_address_ + size - slots * sizeof(uint16_t);
+  auto slot_value = [slot_base](int slot_no) {
+    return *reinterpret_cast<const uint16_t *>(slot_base +
+                                               slot_no * sizeof(uint16_t));
+  };
+  // 记录头和键值都在页面内时返回记录头
+  auto record_at = [this, size](uint16_t offset) -> const RecordMeta * {
+    if (offset < sizeof(PageMeta) || offset + sizeof(RecordMeta) > size) {
+      return nullptr;
+    }
+    auto meta = reinterpret_cast<const RecordMeta *>(base_address_ + offset);
+    if (offset + sizeof(RecordMeta) + meta->key_len + meta->val_len > size) {
+      return nullptr;
+    }
+    return meta;
+  };
+  auto key_of = [this](uint16_t offset, const RecordMeta *meta) {
+    return string_view(base_address_ + offset + sizeof(RecordMeta),
+                       meta->key_len);
+  };
+
+  // 与 LocateSlot 相同, 首尾两个槽是虚拟记录, 不需要比较
+  int lo = 0, hi = slots;
+  while (lo < hi) {
+    int mid = (lo + hi) >> 1;
+    int cmp_res;
+    if (mid == 0 || mid == slots - 1) {
+      cmp_res = mid ? -1 : 1;
+    } else {
+      uint16_t offset = slot_value(mid);
+      auto header = record_at(offset);
+      if (header == nullptr) {
+        return false;
+      }
+      cmp_res = compare(key_of(offset, header), key);
+    }
+    if (cmp_res > 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // 与 UnmodifiedLowerBound 相同, 在槽内的记录链表中向后查找
+  auto prev = record_at(slot_value(lo - 1));
+  size_t max_steps = size / sizeof(RecordMeta);
+  for (size_t step = 0; prev != nullptr && step < max_steps; step++) {
+    uint16_t offset = prev->next;
+    auto cur = record_at(offset);
+    if (cur == nullptr) {
+      return false;
+    }
+    string_view data = key_of(offset, cur);
+    if (cur->owned || compare(key, data) >= 0) {
+      record->key = data;
+      record->val = {data.data() + data.size(), cur->val_len};
+      return true;
+    }
+    prev = cur;
+  }
+  return false;
+}
+
 /**
  * @brief 查找第一个小于指定key最大记录的位置
  *
@@ -1069,7 +1180,7 @@ uint16_t Page::Fill(uint16_t offset, string_view data) {
   return 0;
 }
 
-string_view Page::View(uint16_t offset, size_t len) {
+string_view Page::View(uint16_t offset, size_t len) const {
   return {base_address_ + offset, len};
 }
 
@@ -1085,12 +1196,12 @@ uint16_t Page::ValidDataSize() const {
  */
 Iterator<Record> Page::Iterator() noexcept { return {this, meta_->use}; }
 
-string_view Page::Key(uint16_t record_address) {
-  auto meta = this->get_arribute<RecordMeta>(record_address);
+string_view Page::Key(uint16_t record_address) const {
+  auto meta = this->UnmodifiedAttribute<RecordMeta>(record_address);
   return this->View(record_address + sizeof(RecordMeta), meta->key_len);
 }
-string_view Page::Value(uint16_t record_address) {
-  auto meta = this->get_arribute<RecordMeta>(record_address);
+string_view Page::Value(uint16_t record_address) const {
+  auto meta = this->UnmodifiedAttribute<RecordMeta>(record_address);
   return this->View(record_address + sizeof(RecordMeta) + meta->key_len,
                     meta->val_len);
 }
@@ -1099,8 +1210,8 @@ string_view Page::Value(uint16_t record_address) {
  * @brief 遍历页面中的节点
  *
  */
-void Page::scan_use() noexcept {
-  auto use = get_arribute<RecordMeta>(meta_->use);
+void Page::scan_use() const noexcept {
+  auto use = UnmodifiedAttribute<RecordMeta>(meta_->use);
   uint16_t offset = meta_->use;
   cout << "meta=" << *meta_ << endl;
   cout << "use=[" << endl;
@@ -1114,7 +1225,7 @@ void Page::scan_use() noexcept {
          << fmt::format("[offset={}, key={}, val={}]", offset, key, val)
          << endl;
     offset = use->next;
-    use = get_arribute<RecordMeta>(use->next);
+    use = UnmodifiedAttribute<RecordMeta>(use->next);
   }
   cout << "]" << endl;
 }
@@ -1,9 +1,12 @@
 #include "buffer/replacer.h"
 
+#include <algorithm>
 #include <iostream>
 
 using std::cout;
 using std::endl;
+using std::max;
+using std::min;
 using std::nullopt;
 
 #pragma region "LRUReplacer"
@@ -96,4 +99,439 @@ void LRUReplacer::scan() {
   cout << endl;
 }
 
-#pragma endregion
\ No newline at end of file
+vector<frame_id_t> LRUReplacer::Snapshot() {
+  lock_guard<mutex> guard(lock_);
+  vector<frame_id_t> frame_ids;
+  frame_ids.reserve(size_);
+  for (auto cur = head_->next; cur != tail_; cur = cur->next) {
+    frame_ids.emplace_back(cur->data);
+  }
+  return frame_ids;
+}
+
+#pragma endregion
+
+#pragma region "ClockReplacer"
+
+ClockReplacer::ClockReplacer(size_t capacity)
+    : capacity_(capacity), hand_(0), size_(0) {
+  states_ = new atomic<uint8_t>[capacity_];
+  for (size_t i = 0; i < capacity_; i++) {
+    states_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+ClockReplacer::~ClockReplacer() { delete[] states_; }
+
+optional<frame_id_t> ClockReplacer::Victim() {
+  // 第一圈清除引用位, 第二圈一定能找到可淘汰的帧;
+  // 并发 Unpin 会重新设置引用位, 因此限定扫描的步数
+  for (size_t step = 0; step < 3 * capacity_; step++) {
+    if (size_.load(std::memory_order_acquire) == 0) {
+      return nullopt;
+    }
+    size_t frame_id =
+        hand_.fetch_add(1, std::memory_order_relaxed) % capacity_;
+    auto &state = states_[frame_id];
+    uint8_t current = state.load(std::memory_order_acquire);
+    if (!(current & kEvictable)) {
+      continue;
+    }
+    if (current & kReferenced) {
+      state.compare_exchange_strong(current, current & ~kReferenced,
+                                    std::memory_order_acq_rel);
+      continue;
+    }
+    if (state.compare_exchange_strong(current, 0, std::memory_order_acq_rel)) {
+      size_.fetch_sub(1, std::memory_order_acq_rel);
+      return frame_id;
+    }
+  }
+  return nullopt;
+}
+
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  uint8_t prev = states_[frame_id].exchange(0, std::memory_order_acq_rel);
+  if (prev & kEvictable) {
+    size_.fetch_sub(1, std::memory_order_acq_rel);
+  }
+}
+
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  uint8_t prev = states_[frame_id].exchange(kEvictable | kReferenced,
+                                            std::memory_order_acq_rel);
+  if (!(prev & kEvictable)) {
+    size_.fetch_add(1, std::memory_order_acq_rel);
+  }
+}
+
+size_t ClockReplacer::size() { return size_.load(std::memory_order_acquire); }
+
+void ClockReplacer::scan() {
+  for (size_t i = 0; i < capacity_; i++) {
+    uint8_t state = states_[i].load(std::memory_order_relaxed);
+    if (state & kEvictable) {
+      cout << i << ((state & kReferenced) ? "* " : " ");
+    }
+  }
+  cout << endl;
+}
+
+vector<frame_id_t> ClockReplacer::Snapshot() {
+  // 引用位仍被设置的帧最近被访问过, 排在前面
+  vector<frame_id_t> referenced;
+  vector<frame_id_t> others;
+  for (size_t i = 0; i < capacity_; i++) {
+    uint8_t state = states_[i].load(std::memory_order_relaxed);
+    if (state & kEvictable) {
+      (state & kReferenced ? referenced : others).emplace_back(i);
+    }
+  }
+  referenced.insert(referenced.end(), others.begin(), others.end());
+  return referenced;
+}
+
+#pragma endregion
+
+#pragma region "LRUKReplacer"
+
+LRUKReplacer::LRUKReplacer(size_t capacity, size_t k)
+    : capacity_(capacity), k_(k), size_(0), current_timestamp_(0) {
+  history_ = new uint64_t[capacity_ * k_]();
+  access_count_ = new uint64_t[capacity_]();
+  evictable_ = new bool[capacity_]();
+}
+
+LRUKReplacer::~LRUKReplacer() {
+  delete[] history_;
+  delete[] access_count_;
+  delete[] evictable_;
+}
+
+optional<frame_id_t> LRUKReplacer::Victim() {
+  lock_guard<mutex> guard(lock_);
+  if (size_ == 0) {
+    return nullopt;
+  }
+
+  optional<frame_id_t> victim;
+  bool victim_infinite = false;
+  uint64_t victim_access = 0;
+  for (frame_id_t frame_id = 0; frame_id < static_cast<frame_id_t>(capacity_);
+       frame_id++) {
+    if (!evictable_[frame_id]) {
+      continue;
+    }
+    bool infinite = access_count_[frame_id] < k_;
+    uint64_t access = this->KthAccess(frame_id);
+    // 距离为无穷大的帧优先, 同类中访问时间早的优先
+    if (!victim.has_value() || (infinite && !victim_infinite) ||
+        (infinite == victim_infinite && access < victim_access)) {
+      victim = frame_id;
+      victim_infinite = infinite;
+      victim_access = access;
+    }
+  }
+
+  // 帧将装入新页面, 清空访问历史
+  frame_id_t frame_id = victim.value();
+  evictable_[frame_id] = false;
+  access_count_[frame_id] = 0;
+  size_--;
+  return victim;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  lock_guard<mutex> guard(lock_);
+  if (evictable_[frame_id]) {
+    evictable_[frame_id] = false;
+    size_--;
+  }
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  lock_guard<mutex> guard(lock_);
+  if (!evictable_[frame_id]) {
+    evictable_[frame_id] = true;
+    size_++;
+  }
+}
+
+size_t LRUKReplacer::size() {
+  lock_guard<mutex> guard(lock_);
+  return size_;
+}
+
+void LRUKReplacer::scan() {
+  lock_guard<mutex> guard(lock_);
+  for (frame_id_t frame_id = 0; frame_id < static_cast<frame_id_t>(capacity_);
+       frame_id++) {
+    if (evictable_[frame_id]) {
+      cout << frame_id << "(" << access_count_[frame_id] << ","
+           << this->KthAccess(frame_id) << ") ";
+    }
+  }
+  cout << endl;
+}
+
+vector<frame_id_t> LRUKReplacer::Snapshot() {
+  lock_guard<mutex> guard(lock_);
+  vector<frame_id_t> frame_ids;
+  frame_ids.reserve(size_);
+  for (frame_id_t frame_id = 0; frame_id < static_cast<frame_id_t>(capacity_);
+       frame_id++) {
+    if (evictable_[frame_id]) {
+      frame_ids.emplace_back(frame_id);
+    }
+  }
+  // 与 Victim 的淘汰顺序相反
+  std::sort(frame_ids.begin(), frame_ids.end(),
+            [this](frame_id_t a, frame_id_t b) {
+              bool a_infinite = access_count_[a] < k_;
+              bool b_infinite = access_count_[b] < k_;
+              if (a_infinite != b_infinite) {
+                return b_infinite;
+              }
+              return this->KthAccess(a) > this->KthAccess(b);
+            });
+  return frame_ids;
+}
+
+void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  lock_guard<mutex> guard(lock_);
+  uint64_t &count = access_count_[frame_id];
+  history_[frame_id * k_ + count % k_] = ++current_timestamp_;
+  count++;
+}
+
+uint64_t LRUKReplacer::KthAccess(frame_id_t frame_id) const {
+  uint64_t count = access_count_[frame_id];
+  if (count == 0) {
+    return 0;
+  }
+  // 环形数组中下一个要覆盖的位置即为第K次最近访问
+  return history_[frame_id * k_ + (count < k_ ? 0 : count % k_)];
+}
+
+#pragma endregion
+
+#pragma region "ARCReplacer"
+
+ARCReplacer::ARCReplacer(size_t capacity)
+    : capacity_(capacity), size_(0), target_(0), list_size_{0, 0, 0} {
+  prev_ = new frame_id_t[capacity_ + 2];
+  next_ = new frame_id_t[capacity_ + 2];
+  lists_ = new ListType[capacity_ + 2]();
+  evictable_ = new bool[capacity_]();
+  has_position_ = new bool[capacity_]();
+  positions_ = new PagePosition[capacity_];
+
+  for (frame_id_t sentinel : {capacity_, capacity_ + 1}) {
+    prev_[sentinel] = sentinel;
+    next_[sentinel] = sentinel;
+  }
+}
+
+ARCReplacer::~ARCReplacer() {
+  delete[] prev_;
+  delete[] next_;
+  delete[] lists_;
+  delete[] evictable_;
+  delete[] has_position_;
+  delete[] positions_;
+}
+
+optional<frame_id_t> ARCReplacer::Victim() {
+  lock_guard<mutex> guard(lock_);
+  if (size_ == 0) {
+    return nullopt;
+  }
+
+  // T1 超过目标长度时从 T1 淘汰, 否则从 T2 淘汰; 目标列表全部被固定时
+  // 退而淘汰另一个列表
+  ListType first = list_size_[kRecency] > 0 && list_size_[kRecency] > target_
+                       ? kRecency
+                       : kFrequency;
+  ListType second = first == kRecency ? kFrequency : kRecency;
+  auto victim = this->LeastRecentEvictable(first);
+  if (!victim.has_value()) {
+    victim = this->LeastRecentEvictable(second);
+  }
+  if (!victim.has_value()) {
+    return nullopt;
+  }
+
+  frame_id_t frame_id = victim.value();
+  ListType list_type = lists_[frame_id];
+  this->Unlink(frame_id);
+  evictable_[frame_id] = false;
+  size_--;
+
+  if (has_position_[frame_id]) {
+    auto &ghosts =
+        list_type == kRecency ? recency_ghosts_ : frequency_ghosts_;
+    auto &ghost_index = list_type == kRecency ? recency_ghost_index_
+                                              : frequency_ghost_index_;
+    ghosts.push_front(positions_[frame_id]);
+    ghost_index[positions_[frame_id]] = ghosts.begin();
+    has_position_[frame_id] = false;
+    this->TrimGhosts();
+  }
+  return victim;
+}
+
+void ARCReplacer::Pin(frame_id_t frame_id) {
+  lock_guard<mutex> guard(lock_);
+  if (evictable_[frame_id]) {
+    evictable_[frame_id] = false;
+    size_--;
+  }
+}
+
+void ARCReplacer::Unpin(frame_id_t frame_id) {
+  lock_guard<mutex> guard(lock_);
+  if (lists_[frame_id] == kNone) {
+    this->Link(frame_id, kRecency);
+  }
+  if (!evictable_[frame_id]) {
+    evictable_[frame_id] = true;
+    size_++;
+  }
+}
+
+size_t ARCReplacer::size() {
+  lock_guard<mutex> guard(lock_);
+  return size_;
+}
+
+void ARCReplacer::scan() {
+  lock_guard<mutex> guard(lock_);
+  for (ListType list_type : {kRecency, kFrequency}) {
+    frame_id_t sentinel = capacity_ + list_type - 1;
+    cout << (list_type == kRecency ? "T1: " : "T2: ");
+    for (frame_id_t cur = next_[sentinel]; cur != sentinel; cur = next_[cur]) {
+      cout << cur << (evictable_[cur] ? " " : "* ");
+    }
+    cout << endl;
+  }
+  cout << "B1=" << recency_ghosts_.size()
+       << ", B2=" << frequency_ghosts_.size() << ", p=" << target_ << endl;
+}
+
+vector<frame_id_t> ARCReplacer::Snapshot() {
+  lock_guard<mutex> guard(lock_);
+  vector<frame_id_t> frame_ids;
+  frame_ids.reserve(list_size_[kRecency] + list_size_[kFrequency]);
+  for (ListType list_type : {kFrequency, kRecency}) {
+    frame_id_t sentinel = capacity_ + list_type - 1;
+    for (frame_id_t cur = next_[sentinel]; cur != sentinel; cur = next_[cur]) {
+      frame_ids.emplace_back(cur);
+    }
+  }
+  return frame_ids;
+}
+
+void ARCReplacer::RecordAccess(frame_id_t frame_id) {
+  lock_guard<mutex> guard(lock_);
+  if (lists_[frame_id] != kNone) {
+    this->Unlink(frame_id);
+  }
+  this->Link(frame_id, kFrequency);
+}
+
+void ARCReplacer::RecordLoad(frame_id_t frame_id,
+                             const PagePosition &page_position) {
+  lock_guard<mutex> guard(lock_);
+  if (lists_[frame_id] != kNone) {
+    this->Unlink(frame_id);
+  }
+  positions_[frame_id] = page_position;
+  has_position_[frame_id] = true;
+
+  size_t recency_ghosts = recency_ghosts_.size();
+  size_t frequency_ghosts = frequency_ghosts_.size();
+  if (auto iter = recency_ghost_index_.find(page_position);
+      iter != recency_ghost_index_.end()) {
+    // 刚从 T1 淘汰的页面再次被访问, T1 过小
+    size_t delta = max<size_t>(frequency_ghosts / recency_ghosts, 1);
+    target_ = min(capacity_, target_ + delta);
+    recency_ghosts_.erase(iter->second);
+    recency_ghost_index_.erase(iter);
+    this->Link(frame_id, kFrequency);
+  } else if (auto iter = frequency_ghost_index_.find(page_position);
+             iter != frequency_ghost_index_.end()) {
+    // 刚从 T2 淘汰的页面再次被访问, T2 过小
+    size_t delta = max<size_t>(recency_ghosts / frequency_ghosts, 1);
+    target_ = target_ > delta ? target_ - delta : 0;
+    frequency_ghosts_.erase(iter->second);
+    frequency_ghost_index_.erase(iter);
+    this->Link(frame_id, kFrequency);
+  } else {
+    this->Link(frame_id, kRecency);
+  }
+  this->TrimGhosts();
+}
+
+size_t ARCReplacer::recency_target() {
+  lock_guard<mutex> guard(lock_);
+  return target_;
+}
+
+void ARCReplacer::Link(frame_id_t frame_id, ListType list_type) {
+  frame_id_t sentinel = capacity_ + list_type - 1;
+  frame_id_t first = next_[sentinel];
+  prev_[frame_id] = sentinel;
+  next_[frame_id] = first;
+  prev_[first] = frame_id;
+  next_[sentinel] = frame_id;
+  lists_[frame_id] = list_type;
+  list_size_[list_type]++;
+}
+
+void ARCReplacer::Unlink(frame_id_t frame_id) {
+  next_[prev_[frame_id]] = next_[frame_id];
+  prev_[next_[frame_id]] = prev_[frame_id];
+  list_size_[lists_[frame_id]]--;
+  lists_[frame_id] = kNone;
+}
+
+optional<frame_id_t> ARCReplacer::LeastRecentEvictable(ListType list_type) {
+  frame_id_t sentinel = capacity_ + list_type - 1;
+  for (frame_id_t cur = prev_[sentinel]; cur != sentinel; cur = prev_[cur]) {
+    if (evictable_[cur]) {
+      return cur;
+    }
+  }
+  return nullopt;
+}
+
+void ARCReplacer::TrimGhosts() {
+  while (!recency_ghosts_.empty() &&
+         list_size_[kRecency] + recency_ghosts_.size() > capacity_) {
+    recency_ghost_index_.erase(recency_ghosts_.back());
+    recency_ghosts_.pop_back();
+  }
+  while (!frequency_ghosts_.empty() &&
+         list_size_[kRecency] + list_size_[kFrequency] +
+                 recency_ghosts_.size() + frequency_ghosts_.size() >
+             2 * capacity_) {
+    frequency_ghost_index_.erase(frequency_ghosts_.back());
+    frequency_ghosts_.pop_back();
+  }
+}
+
+#pragma endregion
+
+IReplacer *NewReplacer(ReplacerPolicy policy, size_t capacity) {
+  switch (policy) {
+    case ReplacerPolicy::kARC:
+      return new ARCReplacer(capacity);
+    case ReplacerPolicy::kClock:
+      return new ClockReplacer(capacity);
+    case ReplacerPolicy::kLRUK:
+      return new LRUKReplacer(capacity);
+    case ReplacerPolicy::kLRU:
+    default:
+      return new LRUReplacer(capacity);
+  }
+}
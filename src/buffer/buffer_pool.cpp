@@ -2,137 +2,1336 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <shared_mutex>
 
+#include "buffer/frame_arena.h"
 #include "buffer/replacer.h"
+#include "file.h"
 #include "io/SpaceManager.h"
 #include "io/TableSpaceDiskManager.h"
+#include "io/TableSpaceRegistry.h"
 
 using std::cout;
 using std::endl;
 using std::lock_guard;
+using std::max;
+using std::min;
+using std::remove_if;
+using std::sort;
+using std::shared_lock;
+using std::unique_lock;
 
-LRUBufferPool::LRUBufferPool(size_t capacity) : capacity_(capacity) {
-  replacer = new LRUReplacer(capacity_);
-  space_manager_ = TableSpaceDiskManager::Instance();
+// 乐观读取与写者并发访问帧, 数据竞争检测时忽略这段读取, 由版本号保证结果有效
+#if defined(__SANITIZE_THREAD__)
+extern "C" void AnnotateIgnoreReadsBegin(const char* file, int line);
+extern "C" void AnnotateIgnoreReadsEnd(const char* file, int line);
+#define IGNORE_RACY_READS_BEGIN() AnnotateIgnoreReadsBegin(__FILE__, __LINE__)
+#define IGNORE_RACY_READS_END() AnnotateIgnoreReadsEnd(__FILE__, __LINE__)
+#else
+#define IGNORE_RACY_READS_BEGIN()
+#define IGNORE_RACY_READS_END()
+#endif
 
-  for (frame_id_t frame_id = 0; frame_id < capacity_; frame_id++) {
+LRUBufferPool::LRUBufferPool(size_t capacity, ISpaceManager* space_manager,
+                             ReplacerPolicy policy, size_t max_capacity,
+                             size_t page_size)
+    : capacity_(capacity),
+      page_size_(page_size),
+      space_manager_(space_manager),
+      stopping_(false),
+      high_watermark_ratio_(1.0),
+      low_watermark_ratio_(1.0),
+      high_watermark_(capacity),
+      low_watermark_(capacity),
+      warmup_interval_(0) {
+  if (space_manager_ == nullptr) {
+    space_manager_ = TableSpaceDiskManager::Instance();
+  }
+  async_space_manager_ = dynamic_cast<IAsyncSpaceManager*>(space_manager_);
+
+  // 替换器、页表和脏页标记按最大容量分配, 扩容时不需要重建
+  arena_ = new FrameArena(capacity_, max_capacity, page_size_);
+  replacer = NewReplacer(policy, arena_->max_capacity());
+  page_table_ = new PageTable(arena_->max_capacity());
+  dirty_listed_.resize(arena_->max_capacity(), false);
+  frees_.reserve(capacity_);
+  for (frame_id_t frame_id = capacity_ - 1; frame_id >= 0; frame_id--) {
     frees_.emplace_back(frame_id);
-    frames_.emplace_back(this->NewEmptyFrame(frame_id));
+    this->InitFrame(frame_id);
   }
 }
 
 LRUBufferPool::~LRUBufferPool() {
+  this->StopBackgroundThreads();
   this->FlushAllPage();
-  for (int i = 0; i < capacity_; i++) {
-    delete frames_[i]->buffer;
-    delete frames_[i];
+  if (!warmup_file_.empty()) {
+    this->SaveWarmupFile(warmup_file_);
   }
+  delete page_table_;
+  delete arena_;
   delete replacer;
 }
 
 Frame* LRUBufferPool::FetchPage(PagePosition page_position) {
-  spdlog::info("{}:position={}", __func__, page_position);
+  return this->FetchPage(page_position, nullptr);
+}
+
+Frame* LRUBufferPool::FetchPage(PagePosition page_position, ScanRing* ring) {
+  return this->PinPage(page_position, ring, true);
+}
+
+Frame* LRUBufferPool::NewPage(PagePosition page_position) {
+  return this->PinPage(page_position, nullptr, false);
+}
+
+Frame* LRUBufferPool::PinPage(const PagePosition& page_position,
+                              ScanRing* ring, bool load) {
+  // 命中路径上的日志只在 SPDLOG_ACTIVE_LEVEL 为 trace 时编译
+  SPDLOG_TRACE("{}:position={}", __func__, page_position);
+  // 页面可能正在被其他线程加载或写回, 等待I/O完成,
+  // 同一页面的并发缺页只会产生一次读盘
+  auto resident = this->PinResident(page_position, ring == nullptr);
+  if (resident != nullptr) {
+    return resident;
+  }
+  if (!this->AcceptsPage(page_position)) {
+    spdlog::error("{}:position={}, page size differs from frame size={}",
+                  __func__, page_position, page_size_);
+    return nullptr;
+  }
+
+  unique_lock<mutex> lock(pool_lock_);
+  while (true) {
+    // 持有缓冲池锁时页表中的帧都没有被认领
+    frame_id_t frame_id = page_table_->Find(page_position);
+    if (frame_id != PageTable::INVALID_FRAME) {
+      auto frame = this->frame(frame_id);
+      frame->pin_count.fetch_add(1, std::memory_order_acq_rel);
+      if (ring == nullptr) {
+        frame->referenced.store(true, std::memory_order_relaxed);
+      }
+      lock.unlock();
+      return this->WaitLoaded(frame, page_position);
+    }
+
+    Frame* frame = nullptr;
+    if (ring != nullptr) {
+      frame = this->ClaimRingFrame(ring);
+    }
+    if (frame == nullptr) {
+      frame = this->ClaimFreeFrame();
+    }
+    if (frame == nullptr) {
+      spdlog::info("{}:position={}, no free frame.", __func__, page_position);
+      return nullptr;
+    }
+
+    if (frame->is_dirty) {
+      spdlog::info("{}:flush old page, position={}", __func__,
+                   frame->page_position);
+      // 认领转为固定, 写回期间保留旧页映射, 访问旧页的线程等待写回完成
+      frame->pin_count.fetch_sub(CLAIMED - 1, std::memory_order_acq_rel);
+      if (!this->WriteBack(lock, frame)) {
+        // 写回失败的页面保留在缓冲池中, 交还替换器
+        this->UnPinFrame(frame);
+        return nullptr;
+      }
+      uint64_t pinned = 1;
+      if (frame->pin_count.compare_exchange_strong(
+              pinned, CLAIMED, std::memory_order_acq_rel)) {
+        // 写回后的干净帧解除映射后放回空闲列表, 下一轮直接复用
+        this->DetachFrame(frame);
+        frame->pin_count.fetch_sub(CLAIMED, std::memory_order_acq_rel);
+        if (this->InCapacity(frame)) {
+          frees_.emplace_back(frame->id);
+        }
+      } else {
+        // 写回期间被其他线程固定, 由它们解除固定时还给替换器
+        frame->pin_count.fetch_sub(1, std::memory_order_acq_rel);
+      }
+      // 释放锁期间其他线程可能已经加载了目标页面, 重新查找
+      continue;
+    }
+
+    this->AssignFrame(frame, page_position);
+    if (ring != nullptr) {
+      this->AddToRing(ring, frame);
+    }
+    lock.unlock();
+
+    if (load) {
+      // 文件长度在读取之前获取, 读取期间文件只会变长
+      size_t space_size = space_manager_->size(page_position.space);
+      size_t done =
+          space_manager_->read(page_position.space, page_position.page_address,
+                               frame->buffer, page_size_);
+      if (!this->ReadSucceeded(page_position, space_size, done)) {
+        lock.lock();
+        this->FailLoad(frame, done);
+        lock.unlock();
+        frame->pin_count.fetch_sub(1, std::memory_order_acq_rel);
+        return nullptr;
+      }
+    } else {
+      memset(frame->buffer, 0, page_size_);
+    }
+    this->CompleteLoad(frame);
+    return frame;
+  }
+}
+
+void LRUBufferPool::UnPinPage(PagePosition page_position) {
   lock_guard<mutex> guard(pool_lock_);
-  if (frame_ids_.count(page_position)) {
-    auto frame_id = frame_ids_[page_position];
-    auto frame = frames_[frame_id];
-    frame->pin_count++;
+  frame_id_t frame_id = page_table_->Find(page_position);
+  if (frame_id == PageTable::INVALID_FRAME) {
+    spdlog::info("{}: position={}, not exist.", __func__, page_position);
+    return;
+  }
+  SPDLOG_TRACE("{}: position={}", __func__, page_position);
+  this->UnPinFrame(this->frame(frame_id));
+}
+
+void LRUBufferPool::UnPinPage(Frame* frame) {
+  // 还有其他线程固定时只减少引用计数; 降为0时需要在锁下还给替换器
+  uint64_t pins = frame->pin_count.load(std::memory_order_acquire);
+  while (pins > 1) {
+    if (frame->pin_count.compare_exchange_weak(pins, pins - 1,
+                                               std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+  lock_guard<mutex> guard(pool_lock_);
+  this->UnPinFrame(frame);
+}
+
+bool LRUBufferPool::FlushPage(PagePosition page_position) {
+  unique_lock<mutex> lock(pool_lock_);
+  frame_id_t frame_id = page_table_->Find(page_position);
+  if (frame_id == PageTable::INVALID_FRAME) {
+    spdlog::info("{}: position={}, not exist.", __func__, page_position);
+    return false;
+  }
+  spdlog::info("{}: position={}", __func__, page_position);
+  auto frame = this->frame(frame_id);
+
+  // 固定页面, 防止写回期间被淘汰
+  frame->pin_count++;
+  replacer->Pin(frame->id);
+  lock.unlock();
+  WaitFrameReady(frame);
+  this->WriteLatched(frame);
+  lock.lock();
+  this->UnPinFrame(frame);
+  return true;
+}
+
+void LRUBufferPool::FlushAllPage() {
+  unique_lock<mutex> lock(pool_lock_);
+
+  // 固定所有空闲的脏页, 在锁外写回
+  vector<Frame*> dirty_frames;
+  for (size_t i = 0; i < arena_->capacity(); i++) {
+    auto frame = this->frame(i);
+    if (frame->is_dirty &&
+        frame->state.load(std::memory_order_acquire) == FrameState::kReady) {
+      frame->pin_count++;
+      replacer->Pin(frame->id);
+      dirty_frames.emplace_back(frame);
+    }
+  }
+  lock.unlock();
+
+  this->WriteFrames(dirty_frames);
+
+  lock.lock();
+  for (auto frame : dirty_frames) {
+    this->UnPinFrame(frame);
+  }
+}
+
+void LRUBufferPool::MarkDirty(Frame* frame) {
+  if (frame->is_dirty.exchange(true)) {
+    return;
+  }
+  lock_guard<mutex> guard(pool_lock_);
+  if (!dirty_listed_[frame->id]) {
+    dirty_listed_[frame->id] = true;
+    dirty_frames_.emplace_back(frame->id);
+  }
+  if (dirty_frames_.size() >= high_watermark_) {
+    cleaner_cv_.notify_one();
+  }
+}
+
+bool LRUBufferPool::ReadPageOptimistic(PagePosition page_position,
+                                       const OptimisticReader& reader) {
+  frame_id_t frame_id = page_table_->Find(page_position);
+  if (frame_id == PageTable::INVALID_FRAME) {
+    return false;
+  }
+  auto frame = this->frame(frame_id);
+  for (size_t i = 0; i < OPTIMISTIC_RETRIES; i++) {
+    uint64_t version = frame->version.load(std::memory_order_acquire);
+    if (version & 1) {
+      // 写者正在修改页面或页面正在加载
+      std::this_thread::yield();
+      continue;
+    }
+    if (frame->page_position.space != page_position.space ||
+        frame->page_position.page_address != page_position.page_address) {
+      return false;
+    }
+    // 与持有排他锁的写者并发读取, 由版本号判断结果是否有效
+    IGNORE_RACY_READS_BEGIN();
+    bool consistent = reader(frame->buffer);
+    IGNORE_RACY_READS_END();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (frame->version.load(std::memory_order_relaxed) != version) {
+      continue;
+    }
+    if (!consistent) {
+      return false;
+    }
+    // 已置位时不再写, 读多的热点页面不产生缓存行争用; 淘汰时据此给页面第二次机会
+    if (!frame->referenced.load(std::memory_order_relaxed)) {
+      frame->referenced.store(true, std::memory_order_relaxed);
+    }
+    return true;
+  }
+  return false;
+}
+
+void LRUBufferPool::EnablePageCleaner(double high_watermark,
+                                      double low_watermark) {
+  lock_guard<mutex> guard(pool_lock_);
+  high_watermark_ratio_ = high_watermark;
+  low_watermark_ratio_ = low_watermark;
+  this->UpdateWatermarks();
+  if (!cleaner_.joinable()) {
+    cleaner_ = thread(&LRUBufferPool::CleanPages, this);
+  }
+}
+
+void LRUBufferPool::UpdateWatermarks() {
+  high_watermark_ = max<size_t>(capacity_ * high_watermark_ratio_, 1);
+  low_watermark_ =
+      min<size_t>(capacity_ * low_watermark_ratio_, high_watermark_ - 1);
+}
+
+size_t LRUBufferPool::capacity() {
+  lock_guard<mutex> guard(pool_lock_);
+  return capacity_;
+}
+
+size_t LRUBufferPool::page_size() const { return page_size_; }
+
+size_t LRUBufferPool::MaxPinnedPages(space_t space) {
+  if (!this->AcceptsPage({space, 0})) {
+    return 0;
+  }
+  return this->capacity();
+}
+
+size_t LRUBufferPool::Resize(size_t new_capacity) {
+  lock_guard<mutex> resize_guard(resize_lock_);
+  unique_lock<mutex> lock(pool_lock_);
+  new_capacity = max<size_t>(new_capacity, 1);
+  if (new_capacity > arena_->max_capacity()) {
+    spdlog::warn("{}: new_capacity={} exceeds max_capacity={}", __func__,
+                 new_capacity, arena_->max_capacity());
+    new_capacity = arena_->max_capacity();
+  }
+
+  size_t old_capacity = capacity_;
+  if (new_capacity >= old_capacity) {
+    // 之前缩容退出的帧已经全部解除映射, 重置后和新帧一起加入空闲列表
+    arena_->Grow(new_capacity);
+    for (frame_id_t frame_id = new_capacity - 1;
+         frame_id >= static_cast<frame_id_t>(old_capacity); frame_id--) {
+      this->InitFrame(frame_id);
+      frees_.emplace_back(frame_id);
+    }
+    capacity_ = new_capacity;
+    this->UpdateWatermarks();
+    return capacity_;
+  }
+
+  // 先将超出的帧移出空闲列表和替换器, 之后它们不会再装入新页面
+  capacity_ = new_capacity;
+  this->UpdateWatermarks();
+  frees_.erase(remove_if(frees_.begin(), frees_.end(),
+                         [new_capacity](frame_id_t frame_id) {
+                           return static_cast<size_t>(frame_id) >=
+                                  new_capacity;
+                         }),
+               frees_.end());
+  for (size_t frame_id = new_capacity; frame_id < old_capacity; frame_id++) {
     replacer->Pin(frame_id);
-    return frame;
   }
 
-  auto result = this->GetFreeFrame();
-  if (!result.has_value()) {
-    spdlog::info("{}:position={}, no free frame.", __func__, page_position);
-    return nullptr;
+  // 从最后一帧开始退出, 等待超时的帧及其之前的帧保留在缓冲池中
+  size_t reached = new_capacity;
+  size_t retired = 0;
+  for (size_t frame_id = old_capacity; frame_id-- > new_capacity;) {
+    auto frame = this->frame(frame_id);
+    auto deadline = std::chrono::steady_clock::now() + RESIZE_WAIT_TIMEOUT;
+    bool detached = false;
+    while (!detached) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        break;
+      }
+      if (frame->pin_count > 0 ||
+          frame->state.load(std::memory_order_acquire) != FrameState::kReady) {
+        // 等待持有页面的线程释放
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        lock.lock();
+        continue;
+      }
+      if (frame->is_dirty) {
+        frame->pin_count.fetch_add(1, std::memory_order_acq_rel);
+        bool written = this->WriteBack(lock, frame);
+        frame->pin_count.fetch_sub(1, std::memory_order_acq_rel);
+        if (!written) {
+          // 写回失败时稍后重试, 脏页不能随帧一起退出
+          lock.unlock();
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          lock.lock();
+        }
+        continue;
+      }
+      // 无锁命中可能在检查之后固定帧, 认领成功后才能删除映射;
+      // 退出的帧保持认领状态, 扩容时由 InitFrame 清除
+      if (!Claim(frame)) {
+        continue;
+      }
+      this->DetachFrame(frame);
+      detached = true;
+    }
+    if (!detached) {
+      spdlog::warn("{}: frame={} still in use, capacity stays at {}",
+                   __func__, frame_id, frame_id + 1);
+      reached = frame_id + 1;
+      break;
+    }
+
+    // 周期性释放锁并让出处理器, 让并发的 FetchPage 继续执行
+    if (++retired % RESIZE_BATCH_SIZE == 0) {
+      lock.unlock();
+      std::this_thread::yield();
+      lock.lock();
+    }
   }
 
-  frame_id_t frame_id = result.value();
-  auto frame = frames_[frame_id];
+  if (reached > new_capacity) {
+    // 保留的帧重新参与替换: 空闲帧放回空闲列表, 未固定的页面交还替换器;
+    // 仍被固定的帧在解除固定时按新容量交还替换器
+    capacity_ = reached;
+    this->UpdateWatermarks();
+    for (size_t frame_id = new_capacity; frame_id < reached; frame_id++) {
+      auto frame = this->frame(frame_id);
+      if (frame->pin_count.load(std::memory_order_acquire) != 0 ||
+          frame->ring != nullptr) {
+        continue;
+      }
+      if (frame->page_position.space == TableSpaceRegistry::INVALID_SPACE) {
+        frees_.emplace_back(frame_id);
+      } else {
+        replacer->Unpin(frame_id);
+      }
+    }
+  }
+  lock.unlock();
 
-  if (frame->is_dirty) {
-    spdlog::info("{}:flush old page, position={}", __func__, page_position,
-                 frame->page_position);
-    space_manager_->write(frame->page_position.space,
-                          frame->page_position.page_address, frame->buffer,
-                          PAGE_SIZE);
+  arena_->Release(reached, old_capacity);
+  return reached;
+}
+
+void LRUBufferPool::StopBackgroundThreads() {
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    stopping_ = true;
+  }
+  cleaner_cv_.notify_one();
+  prefetch_cv_.notify_one();
+  warmup_cv_.notify_one();
+  if (cleaner_.joinable()) {
+    cleaner_.join();
+  }
+  if (warmer_.joinable()) {
+    warmer_.join();
+  }
+  if (prefetcher_.joinable()) {
+    prefetcher_.join();
   }
 
-  frame_ids_.erase(frame->page_position);
-  frame_ids_[page_position] = frame_id;
+  // 异步预读在完成回调中持有缓冲池锁解除固定, 等待回调退出
+  for (size_t frame_id = 0; frame_id < arena_->capacity(); frame_id++) {
+    WaitFrameReady(this->frame(frame_id));
+  }
+  lock_guard<mutex> guard(pool_lock_);
+}
+
+void LRUBufferPool::Prefetch(PagePosition page_position) {
+  this->Prefetch(vector<PagePosition>{page_position});
+}
+
+void LRUBufferPool::Prefetch(PagePosition page_position, ScanRing* ring) {
+  vector<Frame*> frames;
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    auto frame = this->ReservePrefetchFrame(page_position, ring);
+    if (frame != nullptr) {
+      frames.emplace_back(frame);
+    }
+  }
+  this->IssuePrefetch(frames);
+}
+
+void LRUBufferPool::Prefetch(const vector<PagePosition>& page_positions) {
+  vector<Frame*> frames;
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    for (auto& page_position : page_positions) {
+      auto frame = this->ReservePrefetchFrame(page_position);
+      if (frame != nullptr) {
+        frames.emplace_back(frame);
+      }
+    }
+  }
+  this->IssuePrefetch(frames);
+}
+
+void LRUBufferPool::AssignFrame(Frame* frame,
+                                const PagePosition& page_position) {
+  this->DetachFrame(frame);
+  page_table_->Insert(page_position, frame->id);
 
   frame->is_dirty = false;
-  frame->pin_count = 1;
+  frame->referenced.store(false, std::memory_order_relaxed);
   frame->page_position = page_position;
+  frame->state.store(FrameState::kLoading, std::memory_order_relaxed);
+  // 读盘完成前版本号为奇数, 乐观读者不会读到加载了一半的页面
+  frame->version.fetch_add(1, std::memory_order_acq_rel);
+  replacer->RecordLoad(frame->id, page_position);
+  // 页面位置和状态在解除认领之前写入, 之后无锁命中的线程核对页面位置
+  // 并等待加载完成
+  frame->pin_count.fetch_sub(CLAIMED - 1, std::memory_order_acq_rel);
+}
+
+void LRUBufferPool::CompleteLoad(Frame* frame) {
+  frame->version.fetch_add(1, std::memory_order_release);
+  SetFrameState(frame, FrameState::kReady);
+}
+
+bool LRUBufferPool::ReadSucceeded(const PagePosition& page_position,
+                                  size_t space_size, size_t done) const {
+  return done >= page_size_ ||
+         static_cast<size_t>(page_position.page_address) + done >= space_size;
+}
+
+void LRUBufferPool::FailLoad(Frame* frame, size_t done) {
+  spdlog::error("{}: position={}, done={}, page_size={}", __func__,
+                frame->page_position, done, page_size_);
+  // 版本号先恢复为偶数, 删除映射后仍为偶数
+  frame->version.fetch_add(1, std::memory_order_release);
+  frame->ring = nullptr;
+  this->DetachFrame(frame);
+  // 等待加载的线程仍固定着帧, 空闲列表认领时跳过, 它们解除固定后再复用
+  if (this->InCapacity(frame)) {
+    frees_.emplace_back(frame->id);
+  }
+  SetFrameState(frame, FrameState::kReady);
+}
 
-  space_manager_->read(page_position.space, page_position.page_address,
-                       frame->buffer, PAGE_SIZE);
+Frame* LRUBufferPool::ReservePrefetchFrame(const PagePosition& page_position,
+                                           ScanRing* ring) {
+  if (!this->AcceptsPage(page_position) ||
+      page_table_->Find(page_position) != PageTable::INVALID_FRAME) {
+    return nullptr;
+  }
+  Frame* frame = nullptr;
+  if (ring != nullptr) {
+    frame = this->ClaimRingFrame(ring);
+  }
+  if (frame == nullptr) {
+    frame = this->ClaimFreeFrame();
+  }
+  if (frame == nullptr) {
+    return nullptr;
+  }
+  if (frame->is_dirty) {
+    // 预读不写回脏页, 解除认领后将帧还给替换器
+    frame->pin_count.fetch_sub(CLAIMED, std::memory_order_acq_rel);
+    replacer->Unpin(frame->id);
+    return nullptr;
+  }
+  this->AssignFrame(frame, page_position);
+  if (ring != nullptr) {
+    this->AddToRing(ring, frame);
+  }
+  return frame;
+}
+
+ScanRing::Ring& LRUBufferPool::RingOf(ScanRing* ring) {
+  auto& slots = ring->rings_[this];
+  if (slots.frames.empty()) {
+    // 环不超过容量的 1/8, 小缓冲池中的扫描也留出大部分帧给共享页面
+    size_t size = min(ring->size(), max<size_t>(capacity_ / 8, 1));
+    slots.frames.assign(size, nullptr);
+  }
+  return slots;
+}
 
+Frame* LRUBufferPool::ClaimRingFrame(ScanRing* ring) {
+  auto& slots = this->RingOf(ring);
+  Frame* frame = slots.frames[slots.next];
+  // 被其他线程访问过或修改过的页面不再复用, 换出环后交还替换器
+  if (frame == nullptr || frame->ring != ring || !this->InCapacity(frame) ||
+      frame->is_dirty ||
+      frame->referenced.load(std::memory_order_relaxed) || !Claim(frame)) {
+    return nullptr;
+  }
   return frame;
 }
 
-void LRUBufferPool::UnPinPage(PagePosition page_position) {
+void LRUBufferPool::AddToRing(ScanRing* ring, Frame* frame) {
+  auto& slots = this->RingOf(ring);
+  Frame* old = slots.frames[slots.next];
+  if (old != nullptr && old != frame) {
+    this->LeaveRing(ring, old);
+  }
+  frame->ring = ring;
+  slots.frames[slots.next] = frame;
+  slots.next = (slots.next + 1) % slots.frames.size();
+}
+
+void LRUBufferPool::LeaveRing(ScanRing* ring, Frame* frame) {
+  // 缩容后重新初始化的帧可能已属于其他扫描环
+  if (frame->ring != ring) {
+    return;
+  }
+  frame->ring = nullptr;
+  // 被固定的帧在解除固定时交还替换器
+  if (frame->pin_count.load(std::memory_order_acquire) != 0 ||
+      !this->InCapacity(frame) ||
+      frame->page_position.space == TableSpaceRegistry::INVALID_SPACE) {
+    return;
+  }
+  if (frame->referenced.exchange(false, std::memory_order_relaxed)) {
+    replacer->RecordAccess(frame->id);
+  }
+  replacer->Unpin(frame->id);
+}
+
+void LRUBufferPool::ReleaseScanRing(ScanRing* ring) {
   lock_guard<mutex> guard(pool_lock_);
-  if (frame_ids_.count(page_position) == 0) {
-    spdlog::info("{}: position={}, not exist.", __func__, page_position);
+  auto iter = ring->rings_.find(this);
+  if (iter == ring->rings_.end()) {
     return;
   }
-  spdlog::info("{}: position={}", __func__, page_position);
-  auto frame = frames_[frame_ids_[page_position]];
-  frame->pin_count--;
-  if (frame->pin_count <= 0) {
-    replacer->Unpin(frame->id);
+  for (auto frame : iter->second.frames) {
+    if (frame == nullptr || frame->ring != ring) {
+      continue;
+    }
+    // 只被扫描访问过的干净页面直接放回空闲列表, 扫描结束后不挤占共享页面
+    if (this->InCapacity(frame) && !frame->is_dirty &&
+        !frame->referenced.load(std::memory_order_relaxed) && Claim(frame)) {
+      frame->ring = nullptr;
+      this->DetachFrame(frame);
+      frame->pin_count.fetch_sub(CLAIMED, std::memory_order_acq_rel);
+      frees_.emplace_back(frame->id);
+      continue;
+    }
+    this->LeaveRing(ring, frame);
   }
+  ring->rings_.erase(iter);
 }
 
-bool LRUBufferPool::FlushPage(PagePosition page_position) {
+void LRUBufferPool::IssuePrefetch(const vector<Frame*>& frames) {
+  if (frames.empty()) {
+    return;
+  }
+
+  if (async_space_manager_ != nullptr) {
+    for (auto frame : frames) {
+      auto page_position = frame->page_position;
+      size_t space_size = async_space_manager_->size(page_position.space);
+      async_space_manager_->AsyncRead(
+          page_position.space, page_position.page_address, frame->buffer,
+          page_size_, [this, frame, page_position, space_size](size_t done) {
+            this->CompletePrefetch(frame, page_position, space_size, done);
+          });
+    }
+    async_space_manager_->Submit();
+    return;
+  }
+
   lock_guard<mutex> guard(pool_lock_);
-  if (frame_ids_.count(page_position) == 0) {
-    spdlog::info("{}: position={}, not exist.", __func__, page_position);
-    return false;
+  for (auto frame : frames) {
+    prefetch_queue_.emplace_back(frame);
   }
-  spdlog::info("{}: position={}", __func__, page_position);
-  auto frame_id = frame_ids_[page_position];
-  auto frame = frames_[frame_id];
+  if (!prefetcher_.joinable()) {
+    prefetcher_ = thread(&LRUBufferPool::PrefetchPages, this);
+  }
+  prefetch_cv_.notify_one();
+}
 
-  if (frame->is_dirty) {
-    space_manager_->write(page_position.space, page_position.page_address,
-                          frame->buffer, PAGE_SIZE);
-    frame->is_dirty = false;
+void LRUBufferPool::CompletePrefetch(Frame* frame,
+                                     const PagePosition& page_position,
+                                     size_t space_size, size_t done) {
+  lock_guard<mutex> guard(pool_lock_);
+  if (!this->ReadSucceeded(page_position, space_size, done)) {
+    this->FailLoad(frame, done);
+    frame->pin_count.fetch_sub(1, std::memory_order_acq_rel);
+    return;
+  }
+  this->CompleteLoad(frame);
+  this->UnPinFrame(frame);
+}
+
+void LRUBufferPool::PrefetchPages() {
+  unique_lock<mutex> lock(pool_lock_);
+  while (true) {
+    prefetch_cv_.wait(lock,
+                      [this] { return stopping_ || !prefetch_queue_.empty(); });
+    // 退出前完成队列中的预读, 等待这些页面的线程不会被挂起
+    if (prefetch_queue_.empty()) {
+      return;
+    }
+    auto frame = prefetch_queue_.front();
+    prefetch_queue_.pop_front();
+    lock.unlock();
+
+    auto page_position = frame->page_position;
+    size_t space_size = space_manager_->size(page_position.space);
+    size_t done =
+        space_manager_->read(page_position.space, page_position.page_address,
+                             frame->buffer, page_size_);
+
+    lock.lock();
+    if (!this->ReadSucceeded(page_position, space_size, done)) {
+      this->FailLoad(frame, done);
+      frame->pin_count.fetch_sub(1, std::memory_order_acq_rel);
+      continue;
+    }
+    this->CompleteLoad(frame);
+    this->UnPinFrame(frame);
+  }
+}
+
+bool LRUBufferPool::SaveWarmupFile(const string& path) {
+  vector<PagePosition> page_positions;
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    page_positions.reserve(page_table_->size());
+    vector<bool> saved(arena_->capacity(), false);
+    auto save = [&](frame_id_t frame_id) {
+      if (frame_id >= static_cast<frame_id_t>(capacity_) || saved[frame_id]) {
+        return;
+      }
+      auto frame = this->frame(frame_id);
+      if (page_table_->Find(frame->page_position) != frame_id) {
+        return;
+      }
+      saved[frame_id] = true;
+      page_positions.emplace_back(frame->page_position);
+    };
+
+    // 被固定的页面正在使用, 最热; 其次按替换器从热到冷的顺序
+    page_table_->ForEach([&](const PagePosition&, frame_id_t frame_id) {
+      if (this->frame(frame_id)->pin_count.load(std::memory_order_relaxed) >
+          0) {
+        save(frame_id);
+      }
+    });
+    for (frame_id_t frame_id : replacer->Snapshot()) {
+      save(frame_id);
+    }
+    page_table_->ForEach(
+        [&](const PagePosition&, frame_id_t frame_id) { save(frame_id); });
+  }
+
+  // 格式: 页面数量, 之后每个页面为表空间名长度、表空间名和页地址;
+  // 表空间编号在重启后可能变化, 因此保存文件名
+  string data;
+  uint64_t count = page_positions.size();
+  data.append(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (auto& page_position : page_positions) {
+    const string& name =
+        TableSpaceRegistry::Instance()->Name(page_position.space);
+    uint32_t length = name.size();
+    data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    data.append(name);
+    data.append(reinterpret_cast<const char*>(&page_position.page_address),
+                sizeof(page_position.page_address));
   }
 
+  string tmp_path = path + ".tmp";
+  std::error_code error;
+  std::filesystem::remove(tmp_path, error);
+  {
+    File file;
+    if (!file.open(tmp_path) ||
+        file.write(size_t{0}, data.data(), data.size()) != data.size()) {
+      spdlog::error("{}: failed to write {}", __func__, tmp_path);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp_path, path, error);
+  if (error) {
+    spdlog::error("{}: failed to rename {} to {}: {}", __func__, tmp_path,
+                  path, error.message());
+    return false;
+  }
   return true;
 }
 
-void LRUBufferPool::FlushAllPage() {
+size_t LRUBufferPool::LoadWarmupFile(const string& path) {
+  if (!File::exist(path)) {
+    return 0;
+  }
+  string data;
+  {
+    File file;
+    if (!file.open(path)) {
+      spdlog::error("{}: failed to open {}", __func__, path);
+      return 0;
+    }
+    data.resize(file.size());
+    data.resize(file.read(size_t{0}, data.data(), data.size()));
+  }
+
+  size_t limit;
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    limit = capacity_;
+  }
+
+  // 文件损坏时只使用完整的部分
+  vector<PagePosition> page_positions;
+  size_t offset = 0;
+  auto take = [&](void* value, size_t size) {
+    if (offset + size > data.size()) {
+      return false;
+    }
+    memcpy(value, data.data() + offset, size);
+    offset += size;
+    return true;
+  };
+  uint64_t count = 0;
+  take(&count, sizeof(count));
+  while (page_positions.size() < min<uint64_t>(count, limit)) {
+    uint32_t length;
+    PagePosition page_position;
+    if (!take(&length, sizeof(length)) || offset + length > data.size()) {
+      spdlog::warn("{}: {} is truncated", __func__, path);
+      break;
+    }
+    page_position.space = TableSpaceRegistry::Instance()->Register(
+        string(data.data() + offset, length));
+    offset += length;
+    if (!take(&page_position.page_address,
+              sizeof(page_position.page_address))) {
+      spdlog::warn("{}: {} is truncated", __func__, path);
+      break;
+    }
+    if (page_position.space != TableSpaceRegistry::INVALID_SPACE) {
+      page_positions.emplace_back(page_position);
+    }
+  }
+
+  // 按地址排序后顺序读取, 连续的页面合并为大块读
+  sort(page_positions.begin(), page_positions.end(),
+       [](const PagePosition& l, const PagePosition& r) {
+         return l.space != r.space ? l.space < r.space
+                                   : l.page_address < r.page_address;
+       });
+  page_positions.erase(
+      std::unique(page_positions.begin(), page_positions.end(),
+                  [](const PagePosition& l, const PagePosition& r) {
+                    return l.space == r.space &&
+                           l.page_address == r.page_address;
+                  }),
+      page_positions.end());
+
+  size_t loaded = 0;
+  vector<PagePosition> run;
+  for (size_t begin = 0; begin < page_positions.size();) {
+    auto& first = page_positions[begin];
+    size_t end = begin + 1;
+    while (end < page_positions.size() && end - begin < MAX_READV_PAGES) {
+      auto& next = page_positions[end];
+      if (next.space != first.space ||
+          next.page_address != first.page_address + static_cast<address_t>(
+                                   (end - begin) * page_size_)) {
+        break;
+      }
+      end++;
+    }
+    run.assign(page_positions.begin() + begin, page_positions.begin() + end);
+    if (!this->WarmRun(run, loaded)) {
+      break;
+    }
+    begin = end;
+  }
+  spdlog::info("{}: loaded {} of {} pages from {}", __func__, loaded,
+               page_positions.size(), path);
+  return loaded;
+}
+
+bool LRUBufferPool::WarmRun(const vector<PagePosition>& page_positions,
+                            size_t& loaded) {
+  // 下标与 page_positions 对应, 已在缓冲池中的页面为 nullptr
+  vector<Frame*> frames(page_positions.size(), nullptr);
+  bool more = true;
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    for (size_t i = 0; i < page_positions.size(); i++) {
+      if (stopping_) {
+        more = false;
+        break;
+      }
+      if (!this->AcceptsPage(page_positions[i]) ||
+          page_table_->Find(page_positions[i]) != PageTable::INVALID_FRAME) {
+        continue;
+      }
+      auto frame = this->ClaimFreeFrame(false);
+      if (frame == nullptr) {
+        more = false;
+        break;
+      }
+      this->AssignFrame(frame, page_positions[i]);
+      frames[i] = frame;
+    }
+  }
+
+  // 下标与 page_positions 对应, 读取失败的页面不放入缓冲池
+  vector<bool> failed(frames.size(), false);
+  vector<char*> buffers;
+  for (size_t begin = 0; begin < frames.size();) {
+    if (frames[begin] == nullptr) {
+      begin++;
+      continue;
+    }
+    size_t end = begin;
+    buffers.clear();
+    while (end < frames.size() && frames[end] != nullptr) {
+      buffers.emplace_back(frames[end]->buffer);
+      end++;
+    }
+    auto& first = page_positions[begin];
+    size_t space_size = space_manager_->size(first.space);
+    size_t done = space_manager_->readv(first.space, first.page_address,
+                                        buffers, page_size_);
+    for (size_t i = begin; i < end; i++) {
+      size_t offset = (i - begin) * page_size_;
+      size_t page_done = done > offset ? done - offset : 0;
+      failed[i] =
+          !this->ReadSucceeded(page_positions[i], space_size, page_done);
+      loaded += failed[i] ? 0 : 1;
+    }
+    begin = end;
+  }
+
+  lock_guard<mutex> guard(pool_lock_);
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i] == nullptr) {
+      continue;
+    }
+    if (failed[i]) {
+      this->FailLoad(frames[i], 0);
+      frames[i]->pin_count.fetch_sub(1, std::memory_order_acq_rel);
+      continue;
+    }
+    this->CompleteLoad(frames[i]);
+    this->UnPinFrame(frames[i]);
+  }
+  return more;
+}
+
+void LRUBufferPool::EnableWarmup(const string& path,
+                                 std::chrono::seconds save_interval) {
   lock_guard<mutex> guard(pool_lock_);
+  warmup_file_ = path;
+  warmup_interval_ = save_interval;
+  if (!warmer_.joinable()) {
+    warmer_ = thread(&LRUBufferPool::WarmPages, this);
+  }
+}
 
-  for (int i = 0; i < capacity_; i++) {
-    if (frames_[i]->is_dirty) {
-      auto page_position = frames_[i]->page_position;
-      space_manager_->write(page_position.space, page_position.page_address,
-                            frames_[i]->buffer, PAGE_SIZE);
+void LRUBufferPool::WarmPages() {
+  string path;
+  {
+    lock_guard<mutex> guard(pool_lock_);
+    path = warmup_file_;
+  }
+  this->LoadWarmupFile(path);
+
+  unique_lock<mutex> lock(pool_lock_);
+  while (!stopping_) {
+    if (warmup_interval_.count() == 0) {
+      warmup_cv_.wait(lock, [this] { return stopping_; });
+      break;
+    }
+    if (warmup_cv_.wait_for(lock, warmup_interval_,
+                            [this] { return stopping_; })) {
+      break;
     }
+    path = warmup_file_;
+    lock.unlock();
+    this->SaveWarmupFile(path);
+    lock.lock();
   }
 }
 
-optional<frame_id_t> LRUBufferPool::GetFreeFrame() {
-  if (frees_.size()) {
-    auto frame_id = frees_.front();
-    frees_.pop_front();
-    return frame_id;
+void LRUBufferPool::CleanPages() {
+  unique_lock<mutex> lock(pool_lock_);
+  while (!stopping_) {
+    cleaner_cv_.wait_for(lock, CLEANER_INTERVAL, [this] {
+      return stopping_ || dirty_frames_.size() >= high_watermark_;
+    });
+
+    // 超过高水位后持续写回, 直到降到低水位
+    if (dirty_frames_.size() < high_watermark_) {
+      continue;
+    }
+    while (!stopping_ && dirty_frames_.size() > low_watermark_) {
+      auto frames = this->PickDirtyFrames();
+      if (frames.empty()) {
+        break;
+      }
+      lock.unlock();
+      bool written = this->WriteFrames(frames);
+      lock.lock();
+      for (auto frame : frames) {
+        this->UnPinFrame(frame);
+      }
+      // 写回失败的页面已重新标记为脏页, 等到下一个周期再重试
+      if (!written) {
+        break;
+      }
+    }
   }
-  return replacer->Victim();
 }
 
-Frame* LRUBufferPool::NewEmptyFrame(frame_id_t frame_id) {
-  Frame* frame = new Frame();
-  frame->id = frame_id;
+vector<Frame*> LRUBufferPool::PickDirtyFrames() {
+  vector<Frame*> frames;
+  size_t count = dirty_frames_.size();
+  for (size_t i = 0; i < count && frames.size() < CLEANER_BATCH_SIZE; i++) {
+    frame_id_t frame_id = dirty_frames_.front();
+    dirty_frames_.pop_front();
+    auto frame = this->frame(frame_id);
+    if (!frame->is_dirty) {
+      dirty_listed_[frame_id] = false;
+      continue;
+    }
+    if (frame->pin_count > 0 ||
+        frame->state.load(std::memory_order_acquire) != FrameState::kReady) {
+      dirty_frames_.emplace_back(frame_id);
+      continue;
+    }
+    dirty_listed_[frame_id] = false;
+    frame->pin_count++;
+    replacer->Pin(frame_id);
+    frames.emplace_back(frame);
+  }
+  return frames;
+}
+
+bool LRUBufferPool::WriteBack(unique_lock<mutex>& lock, Frame* frame) {
+  PagePosition page_position = frame->page_position;
+  // 先清除脏标记, 写回期间持有该页的线程再次修改时会重新标记
+  frame->is_dirty = false;
+  frame->state.store(FrameState::kWritingBack, std::memory_order_relaxed);
+  lock.unlock();
+
+  size_t done = space_manager_->write(
+      page_position.space, page_position.page_address, frame->buffer,
+      page_size_);
+  if (done < page_size_) {
+    this->WriteFailed(frame, done);
+  }
+
+  lock.lock();
+  SetFrameState(frame, FrameState::kReady);
+  return done >= page_size_;
+}
+
+bool LRUBufferPool::WriteLatched(Frame* frame) {
+  shared_lock<shared_mutex> latch(frame->latch);
+  if (!frame->is_dirty) {
+    return true;
+  }
   frame->is_dirty = false;
-  frame->pin_count = 0;
-  frame->buffer = new char[PAGE_SIZE];
-  frame->frame_size = PAGE_SIZE;
-  memset(frame->buffer, 0, PAGE_SIZE);
+  size_t done = space_manager_->write(frame->page_position.space,
+                                      frame->page_position.page_address,
+                                      frame->buffer, page_size_);
+  if (done < page_size_) {
+    this->WriteFailed(frame, done);
+    return false;
+  }
+  return true;
+}
+
+void LRUBufferPool::WriteFailed(Frame* frame, size_t done) {
+  spdlog::error("{}: position={}, done={}, page_size={}", __func__,
+                frame->page_position, done, page_size_);
+  this->MarkDirty(frame);
+}
+
+bool LRUBufferPool::WriteFrames(vector<Frame*>& frames) {
+  // 按表空间和页地址排序, 相邻页面合并为一次向量化写
+  sort(frames.begin(), frames.end(), [](Frame* lhs, Frame* rhs) {
+    auto& l = lhs->page_position;
+    auto& r = rhs->page_position;
+    return l.space != r.space ? l.space < r.space
+                              : l.page_address < r.page_address;
+  });
+
+  // 同时持有多个共享锁时只尝试加锁, 避免与持有写守卫的线程互相等待,
+  // 拿不到锁的页面在批量写完成后逐个写回
+  vector<Frame*> latched_frames;
+  vector<Frame*> busy_frames;
+  for (auto frame : frames) {
+    if (!frame->latch.try_lock_shared()) {
+      busy_frames.emplace_back(frame);
+      continue;
+    }
+    if (!frame->is_dirty) {
+      frame->latch.unlock_shared();
+      continue;
+    }
+    frame->is_dirty = false;
+    latched_frames.emplace_back(frame);
+  }
+
+  bool written = true;
+  if (async_space_manager_ != nullptr) {
+    // 异步表空间管理下, 所有写请求按地址顺序一起下发, 再统一等待完成
+    vector<future<size_t>> results;
+    for (auto frame : latched_frames) {
+      auto& page_position = frame->page_position;
+      results.emplace_back(async_space_manager_->AsyncWrite(
+          page_position.space, page_position.page_address, frame->buffer,
+          page_size_));
+    }
+    async_space_manager_->Submit();
+    for (size_t i = 0; i < results.size(); i++) {
+      size_t done = results[i].get();
+      if (done < page_size_) {
+        this->WriteFailed(latched_frames[i], done);
+        written = false;
+      }
+    }
+  } else {
+    vector<const char*> buffers;
+    for (size_t begin = 0; begin < latched_frames.size();) {
+      auto& first = latched_frames[begin]->page_position;
+      size_t end = begin + 1;
+      while (end < latched_frames.size() && end - begin < MAX_WRITEV_PAGES) {
+        auto& next = latched_frames[end]->page_position;
+        if (next.space != first.space ||
+            next.page_address != first.page_address + static_cast<address_t>(
+                                     (end - begin) * page_size_)) {
+          break;
+        }
+        end++;
+      }
+
+      buffers.clear();
+      for (size_t i = begin; i < end; i++) {
+        buffers.emplace_back(latched_frames[i]->buffer);
+      }
+      size_t done = space_manager_->writev(first.space, first.page_address,
+                                           buffers, page_size_);
+      // 不完整的向量化写只有前 done 字节落盘, 其余页面重新标记为脏页
+      for (size_t i = begin; i < end; i++) {
+        size_t offset = (i - begin) * page_size_;
+        if (done < offset + page_size_) {
+          this->WriteFailed(latched_frames[i],
+                            done > offset ? done - offset : 0);
+          written = false;
+        }
+      }
+      begin = end;
+    }
+  }
+
+  for (auto frame : latched_frames) {
+    frame->latch.unlock_shared();
+  }
+  for (auto frame : busy_frames) {
+    if (!this->WriteLatched(frame)) {
+      written = false;
+    }
+  }
+  return written;
+}
+
+void LRUBufferPool::UnPinFrame(Frame* frame) {
+  uint64_t pins = frame->pin_count.load(std::memory_order_acquire);
+  while (pins > 0 && !frame->pin_count.compare_exchange_weak(
+                         pins, pins - 1, std::memory_order_acq_rel)) {
+  }
+  if (pins != 1) {
+    return;
+  }
+  // 扫描环中的帧由扫描复用, 离开扫描环时再交还替换器
+  if (frame->ring != nullptr) {
+    return;
+  }
+  if (frame->referenced.exchange(false, std::memory_order_relaxed)) {
+    replacer->RecordAccess(frame->id);
+  }
+  // 缩容中的帧和已解除映射的空闲帧不再回到替换器
+  if (this->InCapacity(frame) &&
+      frame->page_position.space != TableSpaceRegistry::INVALID_SPACE) {
+    replacer->Unpin(frame->id);
+  }
+}
+
+void LRUBufferPool::ReleaseStalePin(Frame* frame) {
+  if (frame->pin_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  // 查找和固定之间帧被淘汰后又解除了固定, 它已不在替换器中, 重新加入
+  lock_guard<mutex> guard(pool_lock_);
+  if (frame->pin_count.load(std::memory_order_acquire) == 0 &&
+      frame->ring == nullptr && this->InCapacity(frame) &&
+      frame->page_position.space != TableSpaceRegistry::INVALID_SPACE) {
+    replacer->Unpin(frame->id);
+  }
+}
+
+Frame* LRUBufferPool::PinResident(const PagePosition& page_position,
+                                  bool reference) {
+  frame_id_t frame_id = page_table_->Find(page_position);
+  if (frame_id == PageTable::INVALID_FRAME) {
+    return nullptr;
+  }
+  auto frame = this->frame(frame_id);
+  uint64_t pins = frame->pin_count.fetch_add(1, std::memory_order_acq_rel);
+  if (pins & CLAIMED) {
+    // 帧正在被换入新页面, 交给加锁的慢路径
+    this->ReleaseStalePin(frame);
+    return nullptr;
+  }
+  // 固定之后帧不会再被认领, 但加载失败时会删除映射, 加载结束后页面位置
+  // 才稳定; 查找之后帧可能已换入其他页面
+  frame = this->WaitLoaded(frame, page_position);
+  if (frame != nullptr && reference) {
+    frame->referenced.store(true, std::memory_order_relaxed);
+  }
   return frame;
-}
\ No newline at end of file
+}
+
+void LRUBufferPool::DetachFrame(Frame* frame) {
+  if (frame->page_position.space != TableSpaceRegistry::INVALID_SPACE) {
+    page_table_->Erase(frame->page_position, frame->id);
+  }
+  // 之后无锁查找到旧映射的线程核对页面位置时失败, 正在乐观读取旧页面的
+  // 线程核对版本号时失败
+  frame->page_position = {TableSpaceRegistry::INVALID_SPACE, 0};
+  frame->version.fetch_add(2, std::memory_order_acq_rel);
+}
+
+bool LRUBufferPool::AcceptsPage(const PagePosition& page_position) const {
+  return TableSpaceRegistry::Instance()->PageSize(page_position.space) ==
+         page_size_;
+}
+
+bool LRUBufferPool::Claim(Frame* frame) {
+  uint64_t pins = 0;
+  return frame->pin_count.compare_exchange_strong(pins, CLAIMED,
+                                                  std::memory_order_acq_rel);
+}
+
+void LRUBufferPool::SetFrameState(Frame* frame, FrameState state) {
+  frame->state.store(state, std::memory_order_release);
+  frame->state.notify_all();
+}
+
+Frame* LRUBufferPool::WaitLoaded(Frame* frame,
+                                 const PagePosition& page_position) {
+  WaitFrameReady(frame);
+  // 加载失败的帧已删除映射, 页面位置不再相同
+  if (!std::equal_to<PagePosition>()(frame->page_position, page_position)) {
+    this->ReleaseStalePin(frame);
+    return nullptr;
+  }
+  return frame;
+}
+
+void LRUBufferPool::WaitFrameReady(Frame* frame) {
+  FrameState state = frame->state.load(std::memory_order_acquire);
+  while (state != FrameState::kReady) {
+    frame->state.wait(state, std::memory_order_acquire);
+    state = frame->state.load(std::memory_order_acquire);
+  }
+}
+
+Frame* LRUBufferPool::ClaimFreeFrame(bool evict) {
+  // 空闲帧上可能有刚查到旧映射的线程短暂增加的引用计数, 轮换到栈底
+  for (size_t i = frees_.size(); i > 0; i--) {
+    auto frame = this->frame(frees_.back());
+    frees_.pop_back();
+    if (Claim(frame)) {
+      return frame;
+    }
+    frees_.insert(frees_.begin(), frame->id);
+  }
+  if (!evict) {
+    return nullptr;
+  }
+
+  // 无锁命中不从替换器移除帧, 淘汰时跳过被固定的帧;
+  // 乐观读不固定帧, 被乐观读访问过的帧放回替换器, 每轮最多放回容量次
+  size_t second_chances = capacity_;
+  while (true) {
+    auto result = replacer->Victim();
+    if (!result.has_value()) {
+      return nullptr;
+    }
+    auto frame = this->frame(result.value());
+    if (!Claim(frame)) {
+      continue;
+    }
+    if (second_chances > 0 &&
+        frame->referenced.exchange(false, std::memory_order_relaxed)) {
+      second_chances--;
+      frame->pin_count.fetch_sub(CLAIMED, std::memory_order_acq_rel);
+      replacer->RecordAccess(frame->id);
+      replacer->Unpin(frame->id);
+      continue;
+    }
+    return frame;
+  }
+}
+
+void LRUBufferPool::InitFrame(frame_id_t frame_id) {
+  // 帧缓冲区来自按大页对齐的内存区, 满足直接I/O的对齐要求;
+  // 匿名映射初始为0, 不需要清空
+  Frame* frame = this->frame(frame_id);
+  frame->id = frame_id;
+  frame->is_dirty = false;
+  frame->referenced.store(false, std::memory_order_relaxed);
+  frame->ring = nullptr;
+  frame->page_position = {TableSpaceRegistry::INVALID_SPACE, 0};
+  // 缩容退出的帧仍处于认领状态, 清除标记时保留无锁查找短暂增加的计数
+  frame->pin_count.fetch_and(~CLAIMED, std::memory_order_acq_rel);
+  frame->state.store(FrameState::kReady, std::memory_order_relaxed);
+}
+
+bool LRUBufferPool::InCapacity(const Frame* frame) const {
+  return static_cast<size_t>(frame->id) < capacity_;
+}
+
+Frame* LRUBufferPool::frame(frame_id_t frame_id) const {
+  return arena_->frame(frame_id);
+}
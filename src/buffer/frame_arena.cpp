@@ -0,0 +1,112 @@
+#include "buffer/frame_arena.h"
+
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+using std::max;
+using std::min;
+
+FrameArena::FrameArena(size_t capacity, size_t max_capacity,
+                       size_t frame_size)
+    : capacity_(0),
+      max_capacity_(max(capacity, max_capacity)),
+      frame_size_(frame_size),
+      mapped_size_(0),
+      base_(nullptr),
+      huge_pages_(false) {
+  size_t size = max_capacity_ * frame_size_;
+  this->Map((size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+
+  // 帧元数据按最大容量预留, 扩容时原地构造
+  frames_size_ = max(max_capacity_ * sizeof(Frame), static_cast<size_t>(1));
+  void *addr = mmap(nullptr, frames_size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (addr == MAP_FAILED) {
+    spdlog::error("{}: mmap frames size={}, error={}", __func__, frames_size_,
+                  strerror(errno));
+    throw std::bad_alloc();
+  }
+  frames_ = static_cast<Frame *>(addr);
+
+  this->Grow(capacity);
+  spdlog::info("{}: capacity={}, max_capacity={}, size={}, huge_pages={}",
+               __func__, capacity_, max_capacity_, mapped_size_, huge_pages_);
+}
+
+FrameArena::~FrameArena() {
+  for (size_t i = 0; i < capacity_; i++) {
+    frames_[i].~Frame();
+  }
+  munmap(frames_, frames_size_);
+  if (base_ != nullptr) {
+    munmap(base_, mapped_size_);
+  }
+}
+
+size_t FrameArena::Grow(size_t capacity) {
+  capacity = min(capacity, max_capacity_);
+  for (; capacity_ < capacity; capacity_++) {
+    Frame *frame = new (&frames_[capacity_]) Frame();
+    frame->buffer = this->buffer(capacity_);
+    frame->frame_size = frame_size_;
+  }
+  return capacity_;
+}
+
+void FrameArena::Release(frame_id_t begin, frame_id_t end) {
+  if (begin >= end) {
+    return;
+  }
+  if (madvise(this->buffer(begin), (end - begin) * frame_size_,
+              MADV_DONTNEED) != 0) {
+    spdlog::warn("{}: madvise frames=[{}, {}), error={}", __func__, begin, end,
+                 strerror(errno));
+  }
+}
+
+void FrameArena::Map(size_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (addr != MAP_FAILED) {
+    base_ = static_cast<char *>(addr);
+    mapped_size_ = size;
+    huge_pages_ = true;
+    return;
+  }
+
+  // 没有预留的大页时使用普通映射, 多映射一个大页用于对齐起始地址
+  size_t padded_size = size + HUGE_PAGE_SIZE;
+  addr = mmap(nullptr, padded_size, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (addr == MAP_FAILED) {
+    spdlog::error("{}: mmap size={}, error={}", __func__, padded_size,
+                  strerror(errno));
+    throw std::bad_alloc();
+  }
+
+  char *start = static_cast<char *>(addr);
+  char *aligned = reinterpret_cast<char *>(
+      (reinterpret_cast<uintptr_t>(start) + HUGE_PAGE_SIZE - 1) /
+      HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+  if (aligned > start) {
+    munmap(start, aligned - start);
+  }
+  char *end = start + padded_size;
+  if (end > aligned + size) {
+    munmap(aligned + size, end - (aligned + size));
+  }
+
+  base_ = aligned;
+  mapped_size_ = size;
+  huge_pages_ = madvise(base_, mapped_size_, MADV_HUGEPAGE) == 0;
+}
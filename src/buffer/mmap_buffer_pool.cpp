@@ -0,0 +1,67 @@
+#include "buffer/mmap_buffer_pool.h"
+
+#include <spdlog/spdlog.h>
+
+#include "io/MMapSpaceManager.h"
+#include "io/TableSpaceRegistry.h"
+
+using std::lock_guard;
+
+MMapBufferPool::MMapBufferPool()
+    : space_manager_(MMapSpaceManager::Instance()), next_frame_id_(0) {}
+
+MMapBufferPool::~MMapBufferPool() {
+  for (auto& [page_position, frame] : frames_) {
+    delete frame;
+  }
+}
+
+Frame* MMapBufferPool::FetchPage(PagePosition page_position) {
+  lock_guard<mutex> guard(pool_lock_);
+  auto iter = frames_.find(page_position);
+  if (iter != frames_.end()) {
+    iter->second->pin_count++;
+    return iter->second;
+  }
+
+  size_t page_size =
+      TableSpaceRegistry::Instance()->PageSize(page_position.space);
+  char* buffer = space_manager_->Address(
+      page_position.space, page_position.page_address, page_size);
+  if (buffer == nullptr) {
+    spdlog::error("{}: position={}, out of mapping", __func__, page_position);
+    return nullptr;
+  }
+
+  Frame* frame = new Frame();
+  frame->page_position = page_position;
+  frame->id = next_frame_id_++;
+  frame->space = page_position.space;
+  frame->page_address = page_position.page_address;
+  frame->pin_count = 1;
+  frame->frame_size = page_size;
+  frame->buffer = buffer;
+  frame->is_dirty = false;
+  frames_[page_position] = frame;
+  return frame;
+}
+
+void MMapBufferPool::UnPinPage(PagePosition page_position) {
+  lock_guard<mutex> guard(pool_lock_);
+  auto iter = frames_.find(page_position);
+  if (iter == frames_.end()) {
+    return;
+  }
+  Frame* frame = iter->second;
+  if (--frame->pin_count == 0) {
+    frames_.erase(iter);
+    delete frame;
+  }
+}
+
+bool MMapBufferPool::FlushPage(PagePosition page_position) {
+  lock_guard<mutex> guard(pool_lock_);
+  return frames_.count(page_position) > 0;
+}
+
+void MMapBufferPool::FlushAllPage() {}
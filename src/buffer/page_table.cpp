@@ -0,0 +1,95 @@
+#include "buffer/page_table.h"
+
+#include <algorithm>
+#include <bit>
+
+PageTable::PageTable(size_t capacity) : size_(0) {
+  // 装载因子不超过0.5, 探测序列较短
+  size_t slots = std::bit_ceil(std::max<size_t>(capacity * 2, 16));
+  mask_ = slots - 1;
+  slots_ = new Slot[slots];
+  for (size_t i = 0; i < slots; i++) {
+    slots_[i].frame_id.store(INVALID_FRAME, std::memory_order_relaxed);
+  }
+}
+
+PageTable::~PageTable() { delete[] slots_; }
+
+frame_id_t PageTable::Find(const PagePosition &page_position) const {
+  std::equal_to<PagePosition> equal;
+  for (size_t i = this->Home(page_position), probes = 0; probes <= mask_;
+       i = (i + 1) & mask_, probes++) {
+    frame_id_t frame_id = slots_[i].frame_id.load(std::memory_order_acquire);
+    if (frame_id == INVALID_FRAME) {
+      return INVALID_FRAME;
+    }
+    if (equal(this->Key(i), page_position)) {
+      return frame_id;
+    }
+  }
+  return INVALID_FRAME;
+}
+
+void PageTable::Insert(const PagePosition &page_position, frame_id_t frame_id) {
+  std::equal_to<PagePosition> equal;
+  size_t i = this->Home(page_position);
+  while (true) {
+    frame_id_t current = slots_[i].frame_id.load(std::memory_order_relaxed);
+    if (current == INVALID_FRAME) {
+      this->Store(i, page_position, frame_id);
+      size_++;
+      return;
+    }
+    if (equal(this->Key(i), page_position)) {
+      slots_[i].frame_id.store(frame_id, std::memory_order_release);
+      return;
+    }
+    i = (i + 1) & mask_;
+  }
+}
+
+bool PageTable::Erase(const PagePosition &page_position, frame_id_t frame_id) {
+  std::equal_to<PagePosition> equal;
+  size_t hole = this->Home(page_position);
+  while (true) {
+    frame_id_t current = slots_[hole].frame_id.load(std::memory_order_relaxed);
+    if (current == INVALID_FRAME) {
+      return false;
+    }
+    if (equal(this->Key(hole), page_position)) {
+      if (current != frame_id) {
+        return false;
+      }
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  slots_[hole].frame_id.store(INVALID_FRAME, std::memory_order_release);
+  size_--;
+
+  // 将探测序列经过空洞的映射前移, 保证之后的查找不会提前终止
+  for (size_t next = (hole + 1) & mask_;; next = (next + 1) & mask_) {
+    frame_id_t moving = slots_[next].frame_id.load(std::memory_order_relaxed);
+    if (moving == INVALID_FRAME) {
+      return true;
+    }
+    PagePosition key = this->Key(next);
+    size_t home = this->Home(key);
+    // home 循环地位于 (hole, next] 之间时, 映射不能越过空洞
+    if (((next - home) & mask_) < ((next - hole) & mask_)) {
+      continue;
+    }
+    this->Store(hole, key, moving);
+    slots_[next].frame_id.store(INVALID_FRAME, std::memory_order_release);
+    hole = next;
+  }
+}
+
+void PageTable::Store(size_t slot, const PagePosition &page_position,
+                      frame_id_t frame_id) {
+  slots_[slot].space.store(page_position.space, std::memory_order_relaxed);
+  slots_[slot].page_address.store(page_position.page_address,
+                                  std::memory_order_relaxed);
+  slots_[slot].frame_id.store(frame_id, std::memory_order_release);
+}
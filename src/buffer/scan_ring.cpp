@@ -0,0 +1,12 @@
+#include "buffer/scan_ring.h"
+
+#include <algorithm>
+
+#include "buffer/buffer_pool.h"
+
+using std::max;
+
+ScanRing::ScanRing(IBufferPool *pool, size_t size)
+    : pool_(pool), size_(max<size_t>(size, 1)) {}
+
+ScanRing::~ScanRing() { pool_->ReleaseScanRing(this); }
@@ -0,0 +1,141 @@
+#include "buffer/sharded_buffer_pool.h"
+
+#include <algorithm>
+#include <thread>
+
+using std::max;
+
+ShardedBufferPool::ShardedBufferPool(size_t capacity, size_t shards,
+                                     ISpaceManager* space_manager,
+                                     ReplacerPolicy policy,
+                                     size_t max_capacity, size_t page_size) {
+  if (shards == 0) {
+    shards = max(std::thread::hardware_concurrency(), 1u);
+  }
+  size_t shard_capacity = (capacity + shards - 1) / shards;
+  size_t shard_max_capacity = (max_capacity + shards - 1) / shards;
+  for (size_t i = 0; i < shards; i++) {
+    shards_.emplace_back(new LRUBufferPool(shard_capacity, space_manager,
+                                           policy, shard_max_capacity,
+                                           page_size));
+  }
+}
+
+ShardedBufferPool::~ShardedBufferPool() {
+  for (auto shard : shards_) {
+    delete shard;
+  }
+}
+
+Frame* ShardedBufferPool::FetchPage(PagePosition page_position) {
+  return Shard(page_position)->FetchPage(page_position);
+}
+
+Frame* ShardedBufferPool::FetchPage(PagePosition page_position,
+                                    ScanRing* ring) {
+  return Shard(page_position)->FetchPage(page_position, ring);
+}
+
+Frame* ShardedBufferPool::NewPage(PagePosition page_position) {
+  return Shard(page_position)->NewPage(page_position);
+}
+
+void ShardedBufferPool::ReleaseScanRing(ScanRing* ring) {
+  for (auto shard : shards_) {
+    shard->ReleaseScanRing(ring);
+  }
+}
+
+void ShardedBufferPool::UnPinPage(PagePosition page_position) {
+  Shard(page_position)->UnPinPage(page_position);
+}
+
+void ShardedBufferPool::UnPinPage(Frame* frame) {
+  Shard(frame->page_position)->UnPinPage(frame);
+}
+
+bool ShardedBufferPool::FlushPage(PagePosition page_position) {
+  return Shard(page_position)->FlushPage(page_position);
+}
+
+void ShardedBufferPool::FlushAllPage() {
+  for (auto shard : shards_) {
+    shard->FlushAllPage();
+  }
+}
+
+void ShardedBufferPool::MarkDirty(Frame* frame) {
+  Shard(frame->page_position)->MarkDirty(frame);
+}
+
+size_t ShardedBufferPool::MaxPinnedPages(space_t space) {
+  size_t pages = SIZE_MAX;
+  for (auto shard : shards_) {
+    pages = std::min(pages, shard->MaxPinnedPages(space));
+  }
+  return pages;
+}
+
+bool ShardedBufferPool::ReadPageOptimistic(PagePosition page_position,
+                                           const OptimisticReader& reader) {
+  return Shard(page_position)->ReadPageOptimistic(page_position, reader);
+}
+
+void ShardedBufferPool::Prefetch(PagePosition page_position) {
+  Shard(page_position)->Prefetch(page_position);
+}
+
+void ShardedBufferPool::Prefetch(PagePosition page_position,
+                                 ScanRing* ring) {
+  Shard(page_position)->Prefetch(page_position, ring);
+}
+
+void ShardedBufferPool::Prefetch(const vector<PagePosition>& page_positions) {
+  // 按分片拆分, 每个分片批量下发
+  vector<vector<PagePosition>> batches(shards_.size());
+  for (auto& page_position : page_positions) {
+    batches[ShardIndex(page_position)].emplace_back(page_position);
+  }
+  for (size_t i = 0; i < shards_.size(); i++) {
+    if (!batches[i].empty()) {
+      shards_[i]->Prefetch(batches[i]);
+    }
+  }
+}
+
+size_t ShardedBufferPool::Resize(size_t new_capacity) {
+  size_t shard_capacity = (new_capacity + shards_.size() - 1) / shards_.size();
+  size_t capacity = 0;
+  for (auto shard : shards_) {
+    capacity += shard->Resize(shard_capacity);
+  }
+  return capacity;
+}
+
+size_t ShardedBufferPool::shards() const { return shards_.size(); }
+
+void ShardedBufferPool::EnablePageCleaner(double high_watermark,
+                                          double low_watermark) {
+  for (auto shard : shards_) {
+    shard->EnablePageCleaner(high_watermark, low_watermark);
+  }
+}
+
+void ShardedBufferPool::EnableWarmup(const string& path,
+                                     std::chrono::seconds save_interval) {
+  for (size_t i = 0; i < shards_.size(); i++) {
+    shards_[i]->EnableWarmup(path + "." + std::to_string(shards_.size()) +
+                                 "." + std::to_string(i),
+                             save_interval);
+  }
+}
+
+LRUBufferPool* ShardedBufferPool::Shard(const PagePosition& page_position) {
+  return shards_[ShardIndex(page_position)];
+}
+
+size_t ShardedBufferPool::ShardIndex(const PagePosition& page_position) {
+  // 分片内的页表用哈希值的低位分桶, 分片使用高位, 避免两者相关
+  uint64_t h = std::hash<PagePosition>()(page_position);
+  return (h >> 32) % shards_.size();
+}
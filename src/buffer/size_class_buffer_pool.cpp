@@ -0,0 +1,150 @@
+#include "buffer/size_class_buffer_pool.h"
+
+#include <spdlog/spdlog.h>
+
+#include <bit>
+
+#include "buffer/sharded_buffer_pool.h"
+#include "io/TableSpaceRegistry.h"
+
+static_assert(MAX_PAGE_SIZE / MIN_PAGE_SIZE ==
+              1 << (SizeClassBufferPool::SIZE_CLASSES - 1));
+
+SizeClassBufferPool::SizeClassBufferPool(const map<size_t, size_t>& capacities,
+                                         size_t shards,
+                                         ISpaceManager* space_manager,
+                                         ReplacerPolicy policy) {
+  for (size_t i = 0; i < SIZE_CLASSES; i++) {
+    classes_[i] = nullptr;
+  }
+  for (auto& [page_size, capacity] : capacities) {
+    if (!TableSpaceRegistry::ValidPageSize(page_size) || capacity == 0) {
+      spdlog::warn("{}: ignore page_size={}, capacity={}", __func__,
+                   page_size, capacity);
+      continue;
+    }
+    size_t index = std::countr_zero(page_size / MIN_PAGE_SIZE);
+    classes_[index] = new ShardedBufferPool(capacity, shards, space_manager,
+                                            policy, 0, page_size);
+  }
+}
+
+SizeClassBufferPool::~SizeClassBufferPool() {
+  for (auto pool : classes_) {
+    delete pool;
+  }
+}
+
+Frame* SizeClassBufferPool::FetchPage(PagePosition page_position) {
+  return this->FetchPage(page_position, nullptr);
+}
+
+Frame* SizeClassBufferPool::FetchPage(PagePosition page_position,
+                                      ScanRing* ring) {
+  auto pool = SizeClassOf(page_position);
+  if (pool == nullptr) {
+    size_t page_size =
+        TableSpaceRegistry::Instance()->PageSize(page_position.space);
+    spdlog::error("{}: position={}, no size class for page_size={}",
+                  __func__, page_position, page_size);
+    return nullptr;
+  }
+  return pool->FetchPage(page_position, ring);
+}
+
+Frame* SizeClassBufferPool::NewPage(PagePosition page_position) {
+  auto pool = SizeClassOf(page_position);
+  return pool == nullptr ? nullptr : pool->NewPage(page_position);
+}
+
+void SizeClassBufferPool::ReleaseScanRing(ScanRing* ring) {
+  for (auto pool : classes_) {
+    if (pool != nullptr) {
+      pool->ReleaseScanRing(ring);
+    }
+  }
+}
+
+void SizeClassBufferPool::UnPinPage(PagePosition page_position) {
+  auto pool = SizeClassOf(page_position);
+  if (pool != nullptr) {
+    pool->UnPinPage(page_position);
+  }
+}
+
+void SizeClassBufferPool::UnPinPage(Frame* frame) {
+  SizeClass(frame->frame_size)->UnPinPage(frame);
+}
+
+bool SizeClassBufferPool::FlushPage(PagePosition page_position) {
+  auto pool = SizeClassOf(page_position);
+  return pool != nullptr && pool->FlushPage(page_position);
+}
+
+void SizeClassBufferPool::FlushAllPage() {
+  for (auto pool : classes_) {
+    if (pool != nullptr) {
+      pool->FlushAllPage();
+    }
+  }
+}
+
+void SizeClassBufferPool::MarkDirty(Frame* frame) {
+  SizeClass(frame->frame_size)->MarkDirty(frame);
+}
+
+size_t SizeClassBufferPool::MaxPinnedPages(space_t space) {
+  auto pool = SizeClass(TableSpaceRegistry::Instance()->PageSize(space));
+  return pool == nullptr ? 0 : pool->MaxPinnedPages(space);
+}
+
+bool SizeClassBufferPool::ReadPageOptimistic(PagePosition page_position,
+                                             const OptimisticReader& reader) {
+  auto pool = SizeClassOf(page_position);
+  return pool != nullptr && pool->ReadPageOptimistic(page_position, reader);
+}
+
+void SizeClassBufferPool::Prefetch(PagePosition page_position) {
+  auto pool = SizeClassOf(page_position);
+  if (pool != nullptr) {
+    pool->Prefetch(page_position);
+  }
+}
+
+void SizeClassBufferPool::Prefetch(PagePosition page_position,
+                                   ScanRing* ring) {
+  auto pool = SizeClassOf(page_position);
+  if (pool != nullptr) {
+    pool->Prefetch(page_position, ring);
+  }
+}
+
+void SizeClassBufferPool::Prefetch(
+    const vector<PagePosition>& page_positions) {
+  // 按尺寸级别拆分, 每个级别批量下发
+  vector<vector<PagePosition>> batches(SIZE_CLASSES);
+  for (auto& page_position : page_positions) {
+    size_t page_size =
+        TableSpaceRegistry::Instance()->PageSize(page_position.space);
+    batches[std::countr_zero(page_size / MIN_PAGE_SIZE)].emplace_back(
+        page_position);
+  }
+  for (size_t i = 0; i < SIZE_CLASSES; i++) {
+    if (classes_[i] != nullptr && !batches[i].empty()) {
+      classes_[i]->Prefetch(batches[i]);
+    }
+  }
+}
+
+IBufferPool* SizeClassBufferPool::SizeClass(size_t page_size) const {
+  if (!TableSpaceRegistry::ValidPageSize(page_size)) {
+    return nullptr;
+  }
+  return classes_[std::countr_zero(page_size / MIN_PAGE_SIZE)];
+}
+
+IBufferPool* SizeClassBufferPool::SizeClassOf(
+    const PagePosition& page_position) const {
+  return SizeClass(
+      TableSpaceRegistry::Instance()->PageSize(page_position.space));
+}
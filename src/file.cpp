@@ -1,99 +1,305 @@
 #include "file.h"
 
+#include <fcntl.h>
 #include <spdlog/spdlog.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <vector>
 
+#include "basetype.h"
+
+using std::max;
 using std::min;
+using std::vector;
 
 bool File::exist(const std::string &file_path) {
   return std::filesystem::exists(file_path);
 }
 
-File::File(const std::string &db_file) : db_file_name_(db_file) {
-  open(db_file);
+File::File(const std::string &db_file, bool direct_io)
+    : db_file_name_(db_file) {
+  open(db_file, direct_io);
 }
 
-bool File::open(const std::string &db_file) {
+bool File::open(const std::string &db_file, bool direct_io) {
+  lock_guard guard(_file_lock);
   db_file_name_ = db_file;
-  handle_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  if (!handle_.is_open()) {
-    handle_.open(db_file, std::ios::binary | std::ios::app);
-    handle_.close();
-    handle_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  direct_io_ = direct_io;
+  int flags = O_RDWR | O_CREAT;
+  fd_ = ::open(db_file.c_str(), flags | (direct_io_ ? O_DIRECT : 0), 0644);
+  if (fd_ < 0 && direct_io_ && errno == EINVAL) {
+    // 文件系统不支持直接I/O(例如tmpfs), 退回到带缓存的I/O
+    spdlog::warn("{}: file={}, direct io not supported", __func__,
+                 db_file_name_);
+    direct_io_ = false;
+    fd_ = ::open(db_file.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
+    spdlog::error("{}: file={}, error={}", __func__, db_file_name_,
+                  strerror(errno));
+    return false;
+  }
+
+  struct stat buf;
+  if (fstat(fd_, &buf) == 0) {
+    file_size_ = buf.st_size;
   }
-  return handle_.is_open();
+  return true;
 }
 
-bool File::is_open() const { return handle_.is_open(); }
+bool File::is_open() const { return fd_ >= 0; }
 
-void File::read(size_t pos, char *buffer, size_t size) {
-  lock_guard guard(_file_lock);
-  auto max_offset = this->size();
-  if (max_offset <= pos) {
-    spdlog::error("{}: file={}, pos={}, size={}, maxoffset={}", __func__,
-                  this->db_file_name_, pos, size, max_offset);
-    return;
+bool File::is_direct_io() const { return direct_io_; }
+
+size_t File::read(size_t pos, char *buffer, size_t size) {
+  // 文件尾之后的部分视为未写入的空页
+  if (static_cast<int64_t>(pos) >= file_size_.load(std::memory_order_acquire)) {
+    memset(buffer, 0, size);
+    return 0;
   }
-  auto real_size = min(max_offset - pos, size);
-  if (real_size <= 0) {
-    return;
+
+  if (direct_io_ && !aligned(pos, buffer, size)) {
+    return unaligned_read(pos, buffer, size);
   }
-  handle_.seekg(pos);
-  handle_.read(buffer, real_size);
-  if (handle_.bad()) {
-    spdlog::error("{}: file={}, pos={}, size={}, bad={}", __func__,
-                  this->db_file_name_, pos, size, handle_.bad());
-    return;
+
+  size_t done = pread_full(pos, buffer, size);
+  if (done < size) {
+    memset(buffer + done, 0, size - done);
   }
-  spdlog::info("{}: file={}, pos={}, size={}", __func__, this->db_file_name_,
-               pos, size);
+  return done;
+}
+
+size_t File::readv(size_t pos, const iovec *iov, size_t iovcnt) {
+  bool aligned_iov = true;
+  size_t offset = pos;
+  for (size_t i = 0; direct_io_ && i < iovcnt; i++) {
+    if (!aligned(offset, static_cast<const char *>(iov[i].iov_base),
+                 iov[i].iov_len)) {
+      aligned_iov = false;
+      break;
+    }
+    offset += iov[i].iov_len;
+  }
+  if (!aligned_iov) {
+    size_t done = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+      done += read(pos + done, static_cast<char *>(iov[i].iov_base),
+                   iov[i].iov_len);
+    }
+    return done;
+  }
+
+  vector<iovec> remain(iov, iov + iovcnt);
+  size_t index = 0;
+  size_t done = 0;
+  while (index < iovcnt) {
+    int count = min<size_t>(iovcnt - index, IOV_MAX);
+    ssize_t n = preadv(fd_, &remain[index], count, pos + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      spdlog::error("{}: file={}, pos={}, iovcnt={}, error={}", __func__,
+                    db_file_name_, pos + done, iovcnt - index,
+                    strerror(errno));
+    }
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+    while (index < iovcnt && static_cast<size_t>(n) >= remain[index].iov_len) {
+      n -= remain[index].iov_len;
+      index++;
+    }
+    if (index < iovcnt) {
+      remain[index].iov_base = static_cast<char *>(remain[index].iov_base) + n;
+      remain[index].iov_len -= n;
+    }
+  }
+
+  // 文件尾之后的部分视为未写入的空页
+  for (; index < iovcnt; index++) {
+    memset(remain[index].iov_base, 0, remain[index].iov_len);
+  }
+  return done;
 }
 
 size_t File::alloc(const size_t size) {
-  lock_guard guard(_file_lock);
-  int last = last_pos();
-  handle_.seekp(last + size);
-  handle_.write((char *)&MARK, sizeof(size_t));
+  int64_t last = file_size_.fetch_add(size, std::memory_order_acq_rel);
+  if (posix_fallocate(fd_, last, size) != 0) {
+    spdlog::error("{}: file={}, pos={}, size={}", __func__, db_file_name_,
+                  last, size);
+  }
   return last;
 }
 
-size_t File::last_pos() {
-  handle_.seekp(0, std::ios::end);
-  return handle_.tellp();
+size_t File::write(size_t pos, const char *data, size_t len) {
+  if (direct_io_ && !aligned(pos, data, len)) {
+    return unaligned_write(pos, data, len);
+  }
+  size_t done = pwrite_full(pos, data, len);
+  extend(pos + done);
+  return done;
 }
 
-void File::write(size_t pos, const char *data, size_t len) {
-  lock_guard guard(_file_lock);
-  handle_.seekp(pos);
-  handle_.write(data, len);
-  if (handle_.bad()) {
-    spdlog::error("{}: file={}, pos={}, size={}, bad={}", __func__,
-                  this->db_file_name_, pos, len, handle_.bad());
-    return;
+size_t File::writev(size_t pos, const iovec *iov, size_t iovcnt) {
+  bool aligned_iov = true;
+  size_t offset = pos;
+  for (size_t i = 0; direct_io_ && i < iovcnt; i++) {
+    if (!aligned(offset, static_cast<const char *>(iov[i].iov_base),
+                 iov[i].iov_len)) {
+      aligned_iov = false;
+      break;
+    }
+    offset += iov[i].iov_len;
+  }
+  if (!aligned_iov) {
+    // 直接I/O下存在未对齐的缓冲区, 逐个经过中转缓冲区写入
+    size_t done = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+      size_t n = write(pos + done, static_cast<const char *>(iov[i].iov_base),
+                       iov[i].iov_len);
+      done += n;
+      if (n < iov[i].iov_len) {
+        break;
+      }
+    }
+    return done;
   }
-  spdlog::info("{}: file={}, pos={}, size={}", __func__, this->db_file_name_,
-               pos, len);
+
+  // 部分写入时调整剩余的缓冲区, 单次调用不超过 IOV_MAX 个缓冲区
+  vector<iovec> remain(iov, iov + iovcnt);
+  size_t index = 0;
+  size_t done = 0;
+  while (index < iovcnt) {
+    int count = min<size_t>(iovcnt - index, IOV_MAX);
+    ssize_t n = pwritev(fd_, &remain[index], count, pos + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      spdlog::error("{}: file={}, pos={}, iovcnt={}, error={}", __func__,
+                    db_file_name_, pos + done, iovcnt - index,
+                    strerror(errno));
+      break;
+    }
+    done += n;
+    while (index < iovcnt && static_cast<size_t>(n) >= remain[index].iov_len) {
+      n -= remain[index].iov_len;
+      index++;
+    }
+    if (index < iovcnt) {
+      remain[index].iov_base = static_cast<char *>(remain[index].iov_base) + n;
+      remain[index].iov_len -= n;
+    }
+  }
+  extend(pos + done);
+  return done;
 }
 
 void File::append(const char *data, int len) {
-  handle_.seekp(0, std::ios::end);
-  handle_.write(data, len);
+  int64_t last = file_size_.fetch_add(len, std::memory_order_acq_rel);
+  write(last, data, len);
 }
 
-int64_t File::size() {
-  struct stat buf;
-  if (stat(db_file_name_.c_str(), &buf) == 0) {
-    return buf.st_size;
+int64_t File::size() { return file_size_.load(std::memory_order_acquire); }
+
+int File::fd() const { return fd_; }
+
+bool File::aligned(size_t pos, const char *buffer, size_t size) const {
+  return pos % IO_BLOCK_SIZE == 0 && size % IO_BLOCK_SIZE == 0 &&
+         reinterpret_cast<uintptr_t>(buffer) % IO_BLOCK_SIZE == 0;
+}
+
+size_t File::unaligned_read(size_t pos, char *buffer, size_t size) {
+  size_t begin = pos / IO_BLOCK_SIZE * IO_BLOCK_SIZE;
+  size_t end = (pos + size + IO_BLOCK_SIZE - 1) / IO_BLOCK_SIZE * IO_BLOCK_SIZE;
+  char *block = static_cast<char *>(aligned_alloc(IO_BLOCK_SIZE, end - begin));
+
+  size_t done = pread_full(begin, block, end - begin);
+  size_t skip = pos - begin;
+  size_t real_size = done > skip ? min(size, done - skip) : 0;
+  memcpy(buffer, block + skip, real_size);
+  memset(buffer + real_size, 0, size - real_size);
+
+  free(block);
+  return real_size;
+}
+
+size_t File::unaligned_write(size_t pos, const char *data, size_t size) {
+  size_t begin = pos / IO_BLOCK_SIZE * IO_BLOCK_SIZE;
+  size_t end = (pos + size + IO_BLOCK_SIZE - 1) / IO_BLOCK_SIZE * IO_BLOCK_SIZE;
+  char *block = static_cast<char *>(aligned_alloc(IO_BLOCK_SIZE, end - begin));
+
+  // 读改写需要串行化, 避免并发写入同一个块时相互覆盖
+  lock_guard guard(_file_lock);
+  size_t done = pread_full(begin, block, end - begin);
+  memset(block + done, 0, end - begin - done);
+  memcpy(block + (pos - begin), data, size);
+  done = pwrite_full(begin, block, end - begin);
+  extend(begin + done);
+
+  free(block);
+  size_t skip = pos - begin;
+  return done > skip ? min(size, done - skip) : 0;
+}
+
+size_t File::pread_full(size_t pos, char *buffer, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd_, buffer + done, size - done, pos + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      spdlog::error("{}: file={}, pos={}, size={}, error={}", __func__,
+                    db_file_name_, pos, size, strerror(errno));
+    }
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+size_t File::pwrite_full(size_t pos, const char *data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pwrite(fd_, data + done, size - done, pos + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      spdlog::error("{}: file={}, pos={}, size={}, error={}", __func__,
+                    db_file_name_, pos, size, strerror(errno));
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+void File::extend(int64_t end) {
+  int64_t current = file_size_.load(std::memory_order_acquire);
+  while (current < end &&
+         !file_size_.compare_exchange_weak(current, end,
+                                           std::memory_order_acq_rel)) {
   }
-  return -1;
 }
 
 File::~File() {
   lock_guard guard(_file_lock);
-  cout << "file close" << endl;
-  handle_.flush();
-  handle_.close();
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
 }
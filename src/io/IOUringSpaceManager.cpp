@@ -0,0 +1,363 @@
+#include "io/IOUringSpaceManager.h"
+
+#include <linux/io_uring.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "file.h"
+#include "io/TableSpaceDiskManager.h"
+
+using std::atomic_ref;
+using std::lock_guard;
+using std::max;
+using std::pair;
+using std::unique_lock;
+using std::vector;
+
+IOUringSpaceManager::IOUringSpaceManager(unsigned entries, unsigned batch_size)
+    : ring_fd_(-1),
+      batch_size_(max(batch_size, 1u)),
+      sq_ring_(MAP_FAILED),
+      sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)),
+      cq_ring_(MAP_FAILED),
+      unsubmitted_(0),
+      inflight_(0) {
+  if (!Setup(entries)) {
+    spdlog::warn("{}: io_uring not available, fallback to synchronous io",
+                 __func__);
+    return;
+  }
+  reaper_ = thread(&IOUringSpaceManager::Reap, this);
+}
+
+IOUringSpaceManager::~IOUringSpaceManager() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+
+  {
+    // 等待在途请求全部完成, 再提交一个空请求唤醒收割线程退出
+    unique_lock<mutex> lock(submit_lock_);
+    SubmitLocked();
+    inflight_cv_.wait(lock, [this] { return inflight_ == 0; });
+
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_ring_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = 0;
+    sq_array_[index] = index;
+    atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+    unsubmitted_++;
+    SubmitLocked();
+  }
+  reaper_.join();
+
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+bool IOUringSpaceManager::Setup(unsigned entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd_ < 0) {
+    spdlog::error("{}: io_uring_setup, error={}", __func__, strerror(errno));
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = max(sq_ring_size_, cq_ring_size_);
+  }
+
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    spdlog::error("{}: mmap sq ring, error={}", __func__, strerror(errno));
+    close(ring_fd_);
+    ring_fd_ = -1;
+    return false;
+  }
+
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+    spdlog::error("{}: mmap cq ring or sqes, error={}", __func__,
+                  strerror(errno));
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+    ring_fd_ = -1;
+    return false;
+  }
+
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_ring_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+  sq_entries_ = params.sq_entries;
+
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_ring_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  cq_entries_ = params.cq_entries;
+  return true;
+}
+
+bool IOUringSpaceManager::is_open() const { return ring_fd_ >= 0; }
+
+size_t IOUringSpaceManager::read(space_t space, address_t address,
+                                 char *buffer, size_t buffer_size) {
+  auto result = AsyncRead(space, address, buffer, buffer_size);
+  Submit();
+  return result.get();
+}
+
+size_t IOUringSpaceManager::write(space_t space, address_t address,
+                                  const char *buffer, size_t buffer_size) {
+  auto result = AsyncWrite(space, address, buffer, buffer_size);
+  Submit();
+  return result.get();
+}
+
+size_t IOUringSpaceManager::size(space_t space) {
+  return TableSpaceDiskManager::Instance()->size(space);
+}
+
+future<size_t> IOUringSpaceManager::AsyncRead(space_t space, address_t address,
+                                              char *buffer, size_t buffer_size,
+                                              IOCallback callback) {
+  File *file = TableSpaceDiskManager::Instance()->getFile(space);
+  return Enqueue(new Request(file, address, buffer, buffer_size, false,
+                             std::move(callback)));
+}
+
+future<size_t> IOUringSpaceManager::AsyncWrite(space_t space,
+                                               address_t address,
+                                               const char *buffer,
+                                               size_t buffer_size,
+                                               IOCallback callback) {
+  File *file = TableSpaceDiskManager::Instance()->getFile(space);
+  return Enqueue(new Request(file, address, const_cast<char *>(buffer),
+                             buffer_size, true, std::move(callback)));
+}
+
+void IOUringSpaceManager::Submit() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  lock_guard<mutex> guard(submit_lock_);
+  SubmitLocked();
+}
+
+future<size_t> IOUringSpaceManager::Enqueue(Request *request) {
+  future<size_t> result = request->result.get_future();
+
+  // 直接I/O下未对齐的请求交给文件的中转缓冲区处理,
+  // 未注册的表空间直接完成
+  if (ring_fd_ < 0 || request->file == nullptr ||
+      (request->file->is_direct_io() &&
+       !request->file->aligned(request->address, request->buffer,
+                               request->buffer_size))) {
+    Execute(request);
+    return result;
+  }
+
+  unique_lock<mutex> lock(submit_lock_);
+  // 在途请求不超过完成队列容量, 避免完成队列溢出
+  while (inflight_ >= cq_entries_) {
+    SubmitLocked();
+    inflight_cv_.wait(lock);
+  }
+
+  inflight_++;
+  PushLocked(request);
+  if (unsubmitted_ >= batch_size_) {
+    SubmitLocked();
+  }
+  return result;
+}
+
+void IOUringSpaceManager::PushLocked(Request *request) {
+  unsigned tail = *sq_tail_;
+  unsigned head =
+      atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+  if (tail - head >= sq_entries_) {
+    SubmitLocked();
+  }
+
+  unsigned index = tail & *sq_ring_mask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sqe->opcode = request->is_write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = request->file->fd();
+  sqe->addr = reinterpret_cast<uint64_t>(request->buffer + request->done);
+  sqe->len = request->buffer_size - request->done;
+  sqe->off = request->address + request->done;
+  sqe->user_data = reinterpret_cast<uint64_t>(request);
+  sq_array_[index] = index;
+  atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+  unsubmitted_++;
+}
+
+bool IOUringSpaceManager::Advance(Request *request, int result) {
+  if (result == -EINTR || result == -EAGAIN) {
+    return true;
+  }
+  if (result < 0) {
+    spdlog::error("{}: address={}, size={}, done={}, write={}, error={}",
+                  __func__, request->address, request->buffer_size,
+                  request->done, request->is_write, strerror(-result));
+    return false;
+  }
+  if (result == 0) {
+    // 读到文件尾; 写入0字节说明无法继续写入, 按失败处理
+    if (request->is_write) {
+      spdlog::error("{}: address={}, size={}, done={}, no progress", __func__,
+                    request->address, request->buffer_size, request->done);
+    }
+    return false;
+  }
+  request->done += result;
+  return request->done < request->buffer_size;
+}
+
+void IOUringSpaceManager::SubmitLocked() {
+  while (unsubmitted_ > 0) {
+    int submitted =
+        syscall(__NR_io_uring_enter, ring_fd_, unsubmitted_, 0, 0, nullptr, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        std::this_thread::yield();
+        continue;
+      }
+      spdlog::error("{}: io_uring_enter, error={}", __func__, strerror(errno));
+      return;
+    }
+    unsubmitted_ -= submitted;
+  }
+}
+
+void IOUringSpaceManager::Execute(Request *request) {
+  size_t done = 0;
+  if (request->file == nullptr) {
+    if (!request->is_write) {
+      memset(request->buffer, 0, request->buffer_size);
+    }
+  } else if (request->is_write) {
+    done = request->file->write(request->address, request->buffer,
+                                request->buffer_size);
+  } else {
+    done = request->file->read(request->address, request->buffer,
+                               request->buffer_size);
+  }
+  if (request->callback) {
+    request->callback(done);
+  }
+  request->result.set_value(done);
+  delete request;
+}
+
+void IOUringSpaceManager::Complete(Request *request) {
+  size_t done = request->done;
+  if (request->is_write) {
+    request->file->extend(request->address + done);
+  } else if (done < request->buffer_size) {
+    // 文件尾之后的部分视为未写入的空页
+    memset(request->buffer + done, 0, request->buffer_size - done);
+  }
+
+  if (request->callback) {
+    request->callback(done);
+  }
+  request->result.set_value(done);
+  delete request;
+}
+
+void IOUringSpaceManager::Reap() {
+  vector<pair<Request *, int>> completions;
+  vector<Request *> finished;
+  bool stop = false;
+  while (!stop) {
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                      IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (ret < 0 && errno != EINTR) {
+      spdlog::error("{}: io_uring_enter, error={}", __func__, strerror(errno));
+    }
+
+    unsigned head = *cq_head_;
+    unsigned tail =
+        atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+    while (head != tail) {
+      io_uring_cqe *cqe = &cqes_[head & *cq_ring_mask_];
+      if (cqe->user_data == 0) {
+        stop = true;
+      } else {
+        completions.emplace_back(reinterpret_cast<Request *>(cqe->user_data),
+                                 cqe->res);
+      }
+      head++;
+    }
+    atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+
+    if (completions.empty()) {
+      continue;
+    }
+
+    // 不完整的请求保留在途名额重新提交, 其余请求先释放在途名额,
+    // 回调中再次提交请求时不会因名额不足而阻塞
+    finished.clear();
+    {
+      lock_guard<mutex> guard(submit_lock_);
+      bool resubmitted = false;
+      for (auto &[request, result] : completions) {
+        if (Advance(request, result)) {
+          PushLocked(request);
+          resubmitted = true;
+        } else {
+          finished.emplace_back(request);
+        }
+      }
+      if (resubmitted) {
+        SubmitLocked();
+      }
+      inflight_ -= finished.size();
+    }
+    inflight_cv_.notify_all();
+
+    for (auto request : finished) {
+      Complete(request);
+    }
+    completions.clear();
+  }
+}
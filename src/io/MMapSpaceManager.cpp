@@ -0,0 +1,98 @@
+#include "io/MMapSpaceManager.h"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include "io/TableSpaceRegistry.h"
+
+using std::lock_guard;
+using std::min;
+using std::shared_lock;
+
+MMapSpaceManager::~MMapSpaceManager() {
+  for (auto& [space, mapping] : mappings_) {
+    if (mapping.base != nullptr) {
+      munmap(mapping.base, mapping.length);
+    }
+  }
+}
+
+size_t MMapSpaceManager::read(space_t space, address_t address, char* buffer,
+                              size_t buffer_size) {
+  Mapping mapping = getMapping(space);
+  size_t real_size =
+      static_cast<size_t>(address) < mapping.length
+          ? min(mapping.length - address, buffer_size)
+          : 0;
+  if (real_size > 0) {
+    memcpy(buffer, mapping.base + address, real_size);
+  }
+  memset(buffer + real_size, 0, buffer_size - real_size);
+  return real_size;
+}
+
+size_t MMapSpaceManager::write(space_t space, address_t address, const char*,
+                               size_t) {
+  spdlog::error("{}: space={}, address={}, read only tablespace", __func__,
+                space, address);
+  return 0;
+}
+
+char* MMapSpaceManager::Address(space_t space, address_t address,
+                                size_t size) {
+  Mapping mapping = getMapping(space);
+  if (address < 0 || static_cast<size_t>(address) + size > mapping.length) {
+    return nullptr;
+  }
+  return mapping.base + address;
+}
+
+MMapSpaceManager::Mapping MMapSpaceManager::getMapping(space_t space) {
+  {
+    shared_lock<shared_mutex> guard(mapping_lock_);
+    auto iter = mappings_.find(space);
+    if (iter != mappings_.end()) {
+      return iter->second;
+    }
+  }
+
+  lock_guard<shared_mutex> guard(mapping_lock_);
+  auto iter = mappings_.find(space);
+  if (iter != mappings_.end()) {
+    return iter->second;
+  }
+
+  Mapping mapping{nullptr, 0};
+  const string& name = TableSpaceRegistry::Instance()->Name(space);
+  int fd = name.empty() ? -1 : ::open(name.c_str(), O_RDONLY);
+  struct stat buf;
+  if (fd < 0 || fstat(fd, &buf) != 0 || buf.st_size == 0) {
+    spdlog::error("{}: space={}, can not map, error={}", __func__, name,
+                  strerror(errno));
+  } else {
+    void* base = mmap(nullptr, buf.st_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+      spdlog::error("{}: space={}, mmap error={}", __func__, name,
+                    strerror(errno));
+    } else {
+      mapping = {static_cast<char*>(base), static_cast<size_t>(buf.st_size)};
+    }
+  }
+  // 映射建立后不再需要文件描述符
+  if (fd >= 0) {
+    close(fd);
+  }
+  // 映射失败不缓存, 文件创建或写入后再次访问时重新映射
+  if (mapping.base != nullptr) {
+    mappings_[space] = mapping;
+  }
+  return mapping;
+}
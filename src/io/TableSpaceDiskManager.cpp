@@ -1,27 +1,99 @@
 #include "io/TableSpaceDiskManager.h"
 
+#include <spdlog/spdlog.h>
+#include <sys/uio.h>
+
+#include <cstring>
+
 #include "file.h"
+#include "io/TableSpaceRegistry.h"
 
 using std::lock_guard;
 
+TableSpaceDiskManager::TableSpaceDiskManager() {
+  files_ = new atomic<File*>[TableSpaceRegistry::MAX_SPACES];
+  for (space_t space = 0; space < TableSpaceRegistry::MAX_SPACES; space++) {
+    files_[space].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
 size_t TableSpaceDiskManager::read(space_t space, address_t address,
                                    char* buffer, size_t buffer_size) {
   File* file = getFile(space);
-  file->read(address, buffer, buffer_size);
-  return buffer_size;
+  if (file == nullptr) {
+    memset(buffer, 0, buffer_size);
+    return 0;
+  }
+  return file->read(address, buffer, buffer_size);
+}
+
+size_t TableSpaceDiskManager::size(space_t space) {
+  File* file = getFile(space);
+  return file == nullptr ? 0 : file->size();
 }
 
 size_t TableSpaceDiskManager::write(space_t space, address_t address,
                                     const char* buffer, size_t buffer_size) {
   File* file = getFile(space);
-  file->write(address, buffer, buffer_size);
-  return buffer_size;
+  if (file == nullptr) {
+    return 0;
+  }
+  return file->write(address, buffer, buffer_size);
+}
+
+size_t TableSpaceDiskManager::readv(space_t space, address_t address,
+                                    const vector<char*>& buffers,
+                                    size_t buffer_size) {
+  File* file = getFile(space);
+  if (file == nullptr) {
+    for (auto buffer : buffers) {
+      memset(buffer, 0, buffer_size);
+    }
+    return 0;
+  }
+  vector<iovec> iov(buffers.size());
+  for (size_t i = 0; i < buffers.size(); i++) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len = buffer_size;
+  }
+  return file->readv(address, iov.data(), iov.size());
+}
+
+size_t TableSpaceDiskManager::writev(space_t space, address_t address,
+                                     const vector<const char*>& buffers,
+                                     size_t buffer_size) {
+  File* file = getFile(space);
+  if (file == nullptr) {
+    return 0;
+  }
+  vector<iovec> iov(buffers.size());
+  for (size_t i = 0; i < buffers.size(); i++) {
+    iov[i].iov_base = const_cast<char*>(buffers[i]);
+    iov[i].iov_len = buffer_size;
+  }
+  return file->writev(address, iov.data(), iov.size());
+}
+
+void TableSpaceDiskManager::EnableDirectIO(bool enable) {
+  lock_guard<mutex> guard(open_lock_);
+  direct_io_ = enable;
 }
 
 File* TableSpaceDiskManager::getFile(space_t space) {
-  lock_guard<mutex> guard(fetch_file_lock_);
-  if (files_.count(space) == 0) {
-    files_[space] = new File(space);
+  if (space >= TableSpaceRegistry::Instance()->size()) {
+    spdlog::error("{}: space={}, unregistered tablespace", __func__, space);
+    return nullptr;
+  }
+  File* file = files_[space].load(std::memory_order_acquire);
+  if (file != nullptr) {
+    return file;
   }
-  return files_[space];
-}
\ No newline at end of file
+
+  lock_guard<mutex> guard(open_lock_);
+  file = files_[space].load(std::memory_order_relaxed);
+  if (file == nullptr) {
+    file = new File(TableSpaceRegistry::Instance()->Name(space), direct_io_);
+    files_[space].store(file, std::memory_order_release);
+  }
+  return file;
+}
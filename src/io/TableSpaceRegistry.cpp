@@ -0,0 +1,86 @@
+#include "io/TableSpaceRegistry.h"
+
+#include <spdlog/spdlog.h>
+
+#include <mutex>
+
+using std::lock_guard;
+using std::shared_lock;
+
+TableSpaceRegistry::TableSpaceRegistry() : size_(0) {
+  names_ = new atomic<const string*>[MAX_SPACES];
+  page_sizes_ = new atomic<uint32_t>[MAX_SPACES];
+  for (space_t space = 0; space < MAX_SPACES; space++) {
+    names_[space].store(nullptr, std::memory_order_relaxed);
+    page_sizes_[space].store(0, std::memory_order_relaxed);
+  }
+}
+
+TableSpaceRegistry::~TableSpaceRegistry() {
+  for (space_t space = 0; space < MAX_SPACES; space++) {
+    delete names_[space].load(std::memory_order_relaxed);
+  }
+  delete[] names_;
+  delete[] page_sizes_;
+}
+
+space_t TableSpaceRegistry::Register(const string& name) {
+  {
+    shared_lock<shared_mutex> guard(lock_);
+    auto iter = spaces_.find(name);
+    if (iter != spaces_.end()) {
+      return iter->second;
+    }
+  }
+
+  lock_guard<shared_mutex> guard(lock_);
+  auto iter = spaces_.find(name);
+  if (iter != spaces_.end()) {
+    return iter->second;
+  }
+  space_t space = size_.load(std::memory_order_relaxed);
+  if (space >= MAX_SPACES) {
+    spdlog::error("{}: name={}, too many tablespaces", __func__, name);
+    return INVALID_SPACE;
+  }
+  names_[space].store(new string(name), std::memory_order_release);
+  size_.store(space + 1, std::memory_order_release);
+  spaces_[name] = space;
+  return space;
+}
+
+const string& TableSpaceRegistry::Name(space_t space) const {
+  static const string unknown;
+  if (space >= MAX_SPACES) {
+    return unknown;
+  }
+  const string* name = names_[space].load(std::memory_order_acquire);
+  return name != nullptr ? *name : unknown;
+}
+
+bool TableSpaceRegistry::SetPageSize(space_t space, size_t page_size) {
+  if (space >= this->size() || !ValidPageSize(page_size)) {
+    spdlog::error("{}: space={}, invalid page_size={}", __func__, space,
+                  page_size);
+    return false;
+  }
+  page_sizes_[space].store(page_size, std::memory_order_release);
+  return true;
+}
+
+size_t TableSpaceRegistry::PageSize(space_t space) const {
+  if (space >= MAX_SPACES) {
+    return PAGE_SIZE;
+  }
+  uint32_t page_size = page_sizes_[space].load(std::memory_order_acquire);
+  return page_size != 0 ? page_size : PAGE_SIZE;
+}
+
+bool TableSpaceRegistry::ValidPageSize(size_t page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+size_t TableSpaceRegistry::size() const {
+  return size_.load(std::memory_order_acquire);
+}
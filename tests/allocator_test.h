@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "memory/allocator.h"
+#include "memory/buffer.h"
+
+TEST(FixedAllocatorTest, testAllocReuse) {
+  FixedAllocator<100> allocator;
+  std::unordered_set<char *> allocated;
+  allocated.insert(allocator.Alloc());
+  // 分配完第一个内存段中的所有块
+  size_t capacity = allocator.capacity();
+  for (size_t i = 1; i < capacity; i++) {
+    char *buffer = allocator.Alloc();
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(buffer) %
+                     FixedAllocator<100>::ALIGNMENT);
+    ASSERT_TRUE(allocated.insert(buffer).second);
+    memset(buffer, i, 100);
+  }
+  ASSERT_EQ(capacity, allocator.capacity());
+
+  for (char *buffer : allocated) {
+    allocator.Dealloc(buffer);
+  }
+  // 释放的块被重新分配, 不再申请新的内存段
+  for (size_t i = 0; i < capacity; i++) {
+    ASSERT_EQ(1, allocated.count(allocator.Alloc()));
+  }
+  ASSERT_EQ(capacity, allocator.capacity());
+  allocator.Alloc();
+  ASSERT_EQ(2 * capacity, allocator.capacity());
+}
+
+TEST(FixedAllocatorTest, testConcurrentAlloc) {
+  FixedAllocator<PAGE_SIZE> allocator;
+  const int threads = 8;
+  const int rounds = 2000;
+  std::vector<std::thread> workers;
+  std::atomic<int> corrupted = 0;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::vector<char *> held;
+      for (int i = 0; i < rounds; i++) {
+        char *buffer = allocator.Alloc();
+        memset(buffer, t, PAGE_SIZE);
+        held.push_back(buffer);
+        if (held.size() > 32 || i % 3 == 0) {
+          // 其他线程不会拿到仍在使用的块
+          char *victim = held.front();
+          for (int j = 0; j < PAGE_SIZE; j += 512) {
+            corrupted += victim[j] != t;
+          }
+          allocator.Dealloc(victim);
+          held.erase(held.begin());
+        }
+      }
+      for (char *buffer : held) {
+        allocator.Dealloc(buffer);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  ASSERT_EQ(0, corrupted.load());
+}
+
+TEST(FixedAllocatorTest, testPageBuffer) {
+  for (size_t page_size = MIN_PAGE_SIZE; page_size <= MAX_PAGE_SIZE;
+       page_size *= 2) {
+    char *buffer = PageBufferAllocator::Alloc(page_size);
+    memset(buffer, 0, page_size);
+    PageBufferAllocator::Dealloc(buffer, page_size);
+    // 线程缓存后进先出
+    ASSERT_EQ(buffer, PageBufferAllocator::Alloc(page_size));
+    PageBufferAllocator::Dealloc(buffer, page_size);
+  }
+  char *buffer = PageBufferAllocator::Alloc(100);
+  PageBufferAllocator::Dealloc(buffer, 100);
+}
+
+struct SharedBufferTestData {
+  int a;
+  int b;
+};
+
+TEST(SharedBufferTest, testReferenceCount) {
+  SharedBuffer<SharedBufferTestData> buffer(sizeof(SharedBufferTestData), 1,
+                                            2);
+  ASSERT_EQ(1, buffer.reference_count());
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(buffer.buffer()) %
+                   alignof(std::max_align_t));
+
+  std::vector<SharedBuffer<SharedBufferTestData>> copies(3, buffer);
+  ASSERT_EQ(4, buffer.reference_count());
+  SharedBuffer<SharedBufferTestData> moved = std::move(copies.back());
+  copies.pop_back();
+  ASSERT_EQ(4, buffer.reference_count());
+  ASSERT_EQ(buffer.buffer(), moved.buffer());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&buffer] {
+      for (int i = 0; i < 1000; i++) {
+        SharedBuffer<SharedBufferTestData> local = buffer;
+        ASSERT_EQ(2, local->b);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(4, buffer.reference_count());
+
+  copies.clear();
+  buffer = moved;
+  ASSERT_EQ(2, moved.reference_count());
+}
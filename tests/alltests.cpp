@@ -1,4 +1,10 @@
+#include "allocator_test.h"
+#include "bplustreetest.h"
+#include "buffer_pool_test.h"
+#include "file_test.h"
+#include "io_uring_test.h"
 #include "lru_replacer_test.h"
+#include "mmap_test.h"
 #include "pagetest.h"
 
 int main() {
@@ -1,3 +1,194 @@
 #pragma once
 
-#include "bplustree.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bplustree/bplustree.h"
+#include "buffer/buffer_pool.h"
+#include "buffer/sharded_buffer_pool.h"
+#include "buffer/size_class_buffer_pool.h"
+#include "io/TableSpaceDiskManager.h"
+#include "io/TableSpaceRegistry.h"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+class BPlusTreeIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::remove(index_file_path_.c_str());
+    pool_ = new LRUBufferPool(capacity_);
+    index_ = new BPlusTreeIndex(index_file_path_, cmp, pool_);
+  }
+
+  void TearDown() override {
+    delete index_;
+    delete pool_;
+  }
+
+  string Key(int no) { return "key" + to_string(start_record_no_ + no); }
+  string Val(int no) { return "val" + to_string(no); }
+
+  BPlusTreeIndex *index_;
+  IBufferPool *pool_;
+
+  string index_file_path_ = "bplustree_test.index";
+  int capacity_ = 64;
+  int node_size_ = 2000;
+  int start_record_no_ = 100000;
+
+  function<int(string_view, string_view)> cmp = [](string_view key1,
+                                                   string_view key2) -> int {
+    if (key1 == key2) {
+      return 0;
+    }
+    return key1 < key2 ? 1 : -1;
+  };
+};
+
+TEST_F(BPlusTreeIndexTest, testInsertAndSearch) {
+  for (int i = 0; i < node_size_; i++) {
+    ASSERT_EQ(ResultCode::SUCCESS, index_->Insert(Key(i), Val(i)));
+  }
+  for (int i = 0; i < node_size_; i++) {
+    auto val = index_->Search(Key(i));
+    ASSERT_EQ(true, val.has_value());
+    ASSERT_EQ(Val(i), val.value());
+  }
+  ASSERT_EQ(false, index_->Search(Key(node_size_)).has_value());
+}
+
+TEST_F(BPlusTreeIndexTest, testInsertDuplicateKey) {
+  ASSERT_EQ(ResultCode::SUCCESS, index_->Insert(Key(0), Val(0)));
+  ASSERT_EQ(ResultCode::ERROR_KEY_EXIST, index_->Insert(Key(0), Val(1)));
+}
+
+TEST_F(BPlusTreeIndexTest, testEraseAndMerge) {
+  for (int i = 0; i < node_size_; i++) {
+    ASSERT_EQ(ResultCode::SUCCESS, index_->Insert(Key(i), Val(i)));
+  }
+  // 删除大部分记录, 叶子页变空或过少时删除父节点记录并与兄弟页合并
+  for (int i = 0; i < node_size_; i++) {
+    if (i % 10 != 0) {
+      ASSERT_EQ(ResultCode::SUCCESS, index_->Erase(Key(i)));
+    }
+  }
+  for (int i = 0; i < node_size_; i++) {
+    ASSERT_EQ(i % 10 == 0, index_->Search(Key(i)).has_value());
+  }
+}
+
+TEST_F(BPlusTreeIndexTest, testConcurrentSearch) {
+  string path = "bplustree_concurrent_search_test.index";
+  std::remove(path.c_str());
+  LRUBufferPool pool(capacity_);
+  {
+    BPlusTreeIndex index(path, cmp, &pool);
+    for (int i = 0; i < node_size_; i++) {
+      ASSERT_EQ(ResultCode::SUCCESS, index.Insert(Key(i), Val(i)));
+    }
+  }
+
+  // 重新打开后常驻页面在构造时固定, 并发点查只读取常驻页面的集合
+  BPlusTreeIndex index(path, cmp, &pool);
+  std::atomic<int> mismatch = 0;
+  vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < node_size_; i++) {
+        int no = (i * 7 + t) % node_size_;
+        if (index.Search(Key(no)).value_or("") != Val(no)) {
+          mismatch++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, mismatch);
+}
+
+TEST_F(BPlusTreeIndexTest, testPageSize) {
+  // 小页面和大页面的索引共用一个多页面大小的缓冲池
+  string small_path = "bplustree_small_page_test.index";
+  string large_path = "bplustree_large_page_test.index";
+  std::remove(small_path.c_str());
+  std::remove(large_path.c_str());
+  {
+    SizeClassBufferPool pool({{4 * 1024, 64}, {64 * 1024, 16}});
+    BPlusTreeIndex small(small_path, cmp, &pool,
+                         BPlusTreeIndex::DEFAULT_MAX_PINNED_PAGES, 4 * 1024);
+    BPlusTreeIndex large(large_path, cmp, &pool,
+                         BPlusTreeIndex::DEFAULT_MAX_PINNED_PAGES, 64 * 1024);
+    for (int i = 0; i < node_size_; i++) {
+      ASSERT_EQ(ResultCode::SUCCESS, small.Insert(Key(i), Val(i)));
+      ASSERT_EQ(ResultCode::SUCCESS, large.Insert(Key(i), Val(i)));
+    }
+  }
+
+  // 重新打开时使用文件中保存的页面大小
+  SizeClassBufferPool pool({{4 * 1024, 64}, {64 * 1024, 16}});
+  BPlusTreeIndex small(small_path, cmp, &pool);
+  BPlusTreeIndex large(large_path, cmp, &pool);
+  for (int i = 0; i < node_size_; i++) {
+    ASSERT_EQ(Val(i), small.Search(Key(i)).value_or(""));
+    ASSERT_EQ(Val(i), large.Search(Key(i)).value_or(""));
+  }
+  auto registry = TableSpaceRegistry::Instance();
+  ASSERT_EQ(4 * 1024, registry->PageSize(registry->Register(small_path)));
+  ASSERT_EQ(64 * 1024, registry->PageSize(registry->Register(large_path)));
+}
+
+TEST_F(BPlusTreeIndexTest, testSmallPool) {
+  // 小缓冲池中常驻的上层页面不能占满分片, 树有三层时也能正常读写
+  string path = "bplustree_small_pool_test.index";
+  std::remove(path.c_str());
+  ShardedBufferPool pool(16, 4, nullptr, ReplacerPolicy::kLRU, 0, 4 * 1024);
+  BPlusTreeIndex index(path, cmp, &pool,
+                       BPlusTreeIndex::DEFAULT_MAX_PINNED_PAGES, 4 * 1024);
+  auto registry = TableSpaceRegistry::Instance();
+  ASSERT_EQ(4, pool.MaxPinnedPages(registry->Register(path)));
+
+  int count = 20000;
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(ResultCode::SUCCESS, index.Insert(Key(i), Val(i)));
+  }
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(Val(i), index.Search(Key(i)).value_or(""));
+  }
+}
+
+TEST_F(BPlusTreeIndexTest, testDirectIO) {
+  // 直接I/O只影响之后打开的表空间文件, 打开索引文件后立即关闭
+  string path = "bplustree_direct_io_test.index";
+  std::remove(path.c_str());
+  auto disk_manager = TableSpaceDiskManager::Instance();
+  space_t space = TableSpaceRegistry::Instance()->Register(path);
+  disk_manager->EnableDirectIO(true);
+  File *file = disk_manager->getFile(space);
+  disk_manager->EnableDirectIO(false);
+  ASSERT_TRUE(file->is_direct_io());
+
+  // 记录页按页大小对齐, 直接读写帧; 元数据经过中转缓冲区
+  {
+    LRUBufferPool pool(capacity_);
+    BPlusTreeIndex index(path, cmp, &pool);
+    for (int i = 0; i < node_size_; i++) {
+      ASSERT_EQ(ResultCode::SUCCESS, index.Insert(Key(i), Val(i)));
+    }
+  }
+  ASSERT_EQ(0, file->size() % PAGE_SIZE);
+
+  LRUBufferPool pool(capacity_);
+  BPlusTreeIndex index(path, cmp, &pool);
+  for (int i = 0; i < node_size_; i++) {
+    ASSERT_EQ(Val(i), index.Search(Key(i)).value_or(""));
+  }
+}
@@ -0,0 +1,739 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/buffer_pool.h"
+#include "buffer/extend_frame.h"
+#include "buffer/frame_arena.h"
+#include "buffer/page_guard.h"
+#include "buffer/page_table.h"
+#include "buffer/scan_ring.h"
+#include "buffer/sharded_buffer_pool.h"
+#include "io/SpaceManager.h"
+#include "io/TableSpaceDiskManager.h"
+#include "io/TableSpaceRegistry.h"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * @brief 乐观读取时复制整个页面, 用于校验读到的内容
+ */
+inline bool CopyPageOptimistic(IBufferPool *pool, PagePosition page_position,
+                               char *buffer) {
+  return pool->ReadPageOptimistic(page_position, [buffer](const char *data) {
+    memcpy(buffer, data, PAGE_SIZE);
+    return true;
+  });
+}
+
+class ShardedBufferPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::remove(space_.c_str());
+    pool_ = new ShardedBufferPool(capacity_, shards_);
+  }
+
+  void TearDown() override { delete pool_; }
+
+  PagePosition Position(int page_no) {
+    return {space_id_, static_cast<address_t>(page_no) * PAGE_SIZE};
+  }
+
+  IBufferPool *pool_;
+  string space_ = "sharded_buffer_pool_test.space";
+  space_t space_id_ = TableSpaceRegistry::Instance()->Register(space_);
+  int capacity_ = 16;
+  int shards_ = 4;
+  int page_count_ = 256;
+};
+
+TEST_F(ShardedBufferPoolTest, testFetchAfterEvict) {
+  for (int i = 0; i < page_count_; i++) {
+    Frame *frame = pool_->FetchPage(Position(i));
+    ASSERT_NE(nullptr, frame);
+    string data = "page" + to_string(i);
+    memcpy(frame->buffer, data.c_str(), data.size() + 1);
+    frame->is_dirty = true;
+    pool_->UnPinPage(Position(i));
+  }
+
+  for (int i = 0; i < page_count_; i++) {
+    Frame *frame = pool_->FetchPage(Position(i));
+    ASSERT_NE(nullptr, frame);
+    ASSERT_EQ("page" + to_string(i), string(frame->buffer));
+    pool_->UnPinPage(Position(i));
+  }
+}
+
+TEST_F(ShardedBufferPoolTest, testSamePageSameFrame) {
+  Frame *frame1 = pool_->FetchPage(Position(1));
+  Frame *frame2 = pool_->FetchPage(Position(1));
+  ASSERT_EQ(frame1, frame2);
+  ASSERT_EQ(2, frame1->pin_count);
+  pool_->UnPinPage(Position(1));
+  pool_->UnPinPage(Position(1));
+}
+
+TEST_F(ShardedBufferPoolTest, testNewPage) {
+  // 表空间中已有旧数据, 新分配的页面不读盘
+  string old_data(PAGE_SIZE, 'x');
+  TableSpaceDiskManager::Instance()->write(space_id_, Position(3).page_address,
+                                           old_data.data(), PAGE_SIZE);
+  Frame *frame = pool_->NewPage(Position(3));
+  ASSERT_NE(nullptr, frame);
+  ASSERT_EQ(string(PAGE_SIZE, '\0'), string(frame->buffer, PAGE_SIZE));
+  pool_->UnPinPage(frame);
+
+  // 已在缓冲池中的页面直接返回
+  ASSERT_EQ(frame, pool_->FetchPage(Position(3)));
+  pool_->UnPinPage(Position(3));
+}
+
+TEST_F(ShardedBufferPoolTest, testPageGuard) {
+  {
+    WritePageGuard guard(pool_, Position(1));
+    ASSERT_TRUE(guard.valid());
+    memcpy(guard.data(), "guard", 6);
+    ASSERT_FALSE(guard.frame()->is_dirty);
+
+    // 移动后只有新的守卫负责释放
+    WritePageGuard moved = std::move(guard);
+    ASSERT_FALSE(guard.valid());
+    ASSERT_EQ(1, moved.frame()->pin_count);
+  }
+
+  ReadPageGuard reader1(pool_, Position(1));
+  ReadPageGuard reader2(pool_, Position(1));
+  ASSERT_EQ(reader1.frame(), reader2.frame());
+  ASSERT_TRUE(reader1.frame()->is_dirty);
+  ASSERT_EQ(2, reader1.frame()->pin_count);
+  ASSERT_EQ("guard", string(reader2.data()));
+  // 读守卫持有共享锁时不能获取排他锁
+  ASSERT_FALSE(reader1.frame()->latch.try_lock());
+
+  Frame *frame = reader1.frame();
+  reader1.Release();
+  reader2.Release();
+  ASSERT_EQ(0, frame->pin_count);
+  ASSERT_TRUE(frame->latch.try_lock());
+  frame->latch.unlock();
+}
+
+/**
+ * @brief 单个 LRUBufferPool 的测试, 每个测试使用独立的表空间文件
+ *
+ * TableSpaceDiskManager 打开表空间文件后一直持有文件描述符, 删除文件后
+ * 仍能读到之前写入的页面, 测试之间不能共用表空间. 缓冲池的容量和选项
+ * 由各个测试自己决定.
+ */
+class LRUBufferPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    space_ = string("lru_buffer_pool_test_") +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name() +
+             ".space";
+    std::remove(space_.c_str());
+    space_id_ = TableSpaceRegistry::Instance()->Register(space_);
+  }
+
+  PagePosition Position(int page_no) {
+    return {space_id_, static_cast<address_t>(page_no) * PAGE_SIZE};
+  }
+
+  /**
+   * @brief 直接写入表空间, 第 page_no 页以字符串 prefix + page_no 开头
+   */
+  void WritePages(int page_count, const string &prefix) {
+    char buffer[PAGE_SIZE] = {0};
+    for (int i = 0; i < page_count; i++) {
+      string data = prefix + to_string(i);
+      memcpy(buffer, data.c_str(), data.size() + 1);
+      TableSpaceDiskManager::Instance()->write(
+          space_id_, Position(i).page_address, buffer, PAGE_SIZE);
+    }
+  }
+
+  /**
+   * @brief 直接从表空间读取页面开头的字符串
+   */
+  string ReadPage(int page_no) {
+    char buffer[PAGE_SIZE];
+    TableSpaceDiskManager::Instance()->read(
+        space_id_, Position(page_no).page_address, buffer, PAGE_SIZE);
+    return buffer;
+  }
+
+  string space_;
+  space_t space_id_;
+};
+
+/**
+ * @brief 页面保存在内存中的表空间管理
+ *
+ * 读写可以按需失败; 测试可以等待后台线程完成指定次数的写入
+ */
+class MemorySpaceManager : public ISpaceManager {
+ public:
+  size_t read(space_t, address_t address, char *buffer,
+              size_t buffer_size) override {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (fail_reads_) {
+      memset(buffer, 0, buffer_size);
+      return 0;
+    }
+    auto iter = pages_.find(address);
+    if (iter == pages_.end()) {
+      memset(buffer, 0, buffer_size);
+    } else {
+      memcpy(buffer, iter->second.data(), buffer_size);
+    }
+    return buffer_size;
+  }
+
+  size_t write(space_t, address_t address, const char *buffer,
+               size_t buffer_size) override {
+    if (fail_) {
+      return 0;
+    }
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      pages_[address].assign(buffer, buffer_size);
+      size_ = std::max<size_t>(size_, address + buffer_size);
+      writes_++;
+    }
+    written_cv_.notify_all();
+    return buffer_size;
+  }
+
+  /**
+   * @brief 等待累计写入 count 次
+   *
+   * @return false 超时, 只用于防止测试失败时挂起
+   */
+  bool WaitWrites(int count) {
+    std::unique_lock<std::mutex> lock(lock_);
+    return written_cv_.wait_for(lock, std::chrono::seconds(10),
+                                [&] { return writes_ >= count; });
+  }
+
+  size_t size(space_t) override {
+    std::lock_guard<std::mutex> guard(lock_);
+    return size_;
+  }
+
+  int writes() {
+    std::lock_guard<std::mutex> guard(lock_);
+    return writes_;
+  }
+
+  string Page(address_t address) {
+    std::lock_guard<std::mutex> guard(lock_);
+    return pages_.count(address) ? pages_[address].c_str() : "";
+  }
+
+  std::atomic<bool> fail_ = false;
+  std::atomic<bool> fail_reads_ = false;
+
+ private:
+  std::mutex lock_;
+  std::condition_variable written_cv_;
+  std::unordered_map<address_t, string> pages_;
+  size_t size_ = 0;
+  int writes_ = 0;
+};
+
+TEST_F(LRUBufferPoolTest, testConcurrentFetch) {
+  WritePages(16, "page");
+
+  // 多个线程并发访问少量帧, 缺页读盘和脏页写回在锁外进行
+  LRUBufferPool pool(4);
+  std::atomic<int> mismatch = 0;
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 2000; i++) {
+        int page_no = (i * 7 + t) % 16;
+        Frame *frame = pool.FetchPage(Position(page_no));
+        if (frame == nullptr) {
+          continue;
+        }
+        if ("page" + to_string(page_no) != string(frame->buffer)) {
+          mismatch++;
+        }
+        pool.UnPinPage(Position(page_no));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, mismatch);
+}
+
+TEST_F(LRUBufferPoolTest, testPageCleaner) {
+  // 开启前脏页已超过高水位, 后台线程立即写回所有未被固定的脏页
+  MemorySpaceManager space_manager;
+  LRUBufferPool pool(8, &space_manager);
+  for (int i = 0; i < 8; i++) {
+    WritePageGuard guard(&pool, Position(i));
+    string data = "clean" + to_string(i);
+    memcpy(guard.data(), data.c_str(), data.size() + 1);
+  }
+  ASSERT_EQ(0, space_manager.writes());
+
+  pool.EnablePageCleaner(0.5, 0.25);
+  ASSERT_TRUE(space_manager.WaitWrites(8));
+  for (int i = 0; i < 8; i++) {
+    ASSERT_EQ("clean" + to_string(i),
+              space_manager.Page(Position(i).page_address));
+  }
+  ASSERT_EQ(8, space_manager.writes());
+}
+
+TEST_F(LRUBufferPoolTest, testCoalescedFlush) {
+  // 地址连续和不连续的脏页混合, 刷盘后逐页校验
+  LRUBufferPool pool(32);
+  vector<int> page_nos = {7, 3, 4, 5, 20, 6, 0, 21, 9};
+  for (int page_no : page_nos) {
+    WritePageGuard guard(&pool, Position(page_no));
+    string data = "flush" + to_string(page_no);
+    memcpy(guard.data(), data.c_str(), data.size() + 1);
+  }
+  pool.FlushAllPage();
+
+  for (int page_no : page_nos) {
+    ASSERT_EQ("flush" + to_string(page_no), ReadPage(page_no));
+  }
+}
+
+TEST_F(LRUBufferPoolTest, testWriteFailure) {
+  MemorySpaceManager space_manager;
+  LRUBufferPool pool(4, &space_manager);
+  for (int i = 0; i < 4; i++) {
+    WritePageGuard guard(&pool, Position(i));
+    string data = "dirty" + to_string(i);
+    memcpy(guard.data(), data.c_str(), data.size() + 1);
+  }
+
+  // 写回失败的页面重新标记为脏页; 只能淘汰脏页时放弃换入, 页面仍在缓冲池中
+  space_manager.fail_ = true;
+  pool.FlushAllPage();
+  ASSERT_EQ(nullptr, pool.FetchPage(Position(4)));
+  for (int i = 0; i < 4; i++) {
+    ReadPageGuard guard(&pool, Position(i));
+    ASSERT_TRUE(guard.valid());
+    ASSERT_TRUE(guard.frame()->is_dirty);
+    ASSERT_EQ("dirty" + to_string(i), string(guard.data()));
+  }
+
+  space_manager.fail_ = false;
+  pool.FlushAllPage();
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ("dirty" + to_string(i),
+              space_manager.Page(Position(i).page_address));
+  }
+  ReadPageGuard guard(&pool, Position(4));
+  ASSERT_TRUE(guard.valid());
+}
+
+TEST_F(LRUBufferPoolTest, testReadFailure) {
+  MemorySpaceManager space_manager;
+  LRUBufferPool pool(4, &space_manager);
+  for (int i = 0; i < 4; i++) {
+    WritePageGuard guard(&pool, Position(i));
+    string data = "page" + to_string(i);
+    memcpy(guard.data(), data.c_str(), data.size() + 1);
+  }
+  pool.FlushAllPage();
+  // 文件尾之后的页面读出为空页, 同时把之前的页面换出
+  for (int i = 4; i < 8; i++) {
+    ReadPageGuard guard(&pool, Position(i));
+    ASSERT_TRUE(guard.valid());
+  }
+
+  // 文件内的页面读取失败时不留在缓冲池中, 帧可以继续使用
+  space_manager.fail_reads_ = true;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(nullptr, pool.FetchPage(Position(i)));
+  }
+  pool.Prefetch(Position(1));
+  ASSERT_EQ(nullptr, pool.FetchPage(Position(1)));
+  ReadPageGuard empty(&pool, Position(100));
+  ASSERT_TRUE(empty.valid());
+  ASSERT_EQ(string(PAGE_SIZE, '\0'), string(empty.data(), PAGE_SIZE));
+  empty.Release();
+
+  space_manager.fail_reads_ = false;
+  vector<ReadPageGuard> guards;
+  for (int i = 0; i < 4; i++) {
+    guards.emplace_back(&pool, Position(i));
+    ASSERT_TRUE(guards.back().valid());
+    ASSERT_EQ("page" + to_string(i), string(guards.back().data()));
+  }
+}
+
+TEST_F(LRUBufferPoolTest, testPrefetch) {
+  WritePages(9, "page");
+
+  // 预读的页面不被固定, 之后的 FetchPage 等待预读完成
+  LRUBufferPool pool(8);
+  vector<PagePosition> positions;
+  for (int i = 0; i < 8; i++) {
+    positions.emplace_back(Position(i));
+  }
+  pool.Prefetch(positions);
+  pool.Prefetch(Position(8));
+
+  for (int i = 0; i < 8; i++) {
+    ReadPageGuard guard(&pool, Position(i));
+    ASSERT_TRUE(guard.valid());
+    ASSERT_EQ("page" + to_string(i), string(guard.data()));
+    ASSERT_EQ(1, guard.frame()->pin_count);
+  }
+}
+
+TEST(FrameArenaTest, testContiguousBuffers) {
+  FrameArena arena(64);
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(arena.buffer(0)) % IO_BLOCK_SIZE);
+  for (frame_id_t frame_id = 0; frame_id < 64; frame_id++) {
+    ASSERT_EQ(arena.buffer(0) + frame_id * PAGE_SIZE, arena.buffer(frame_id));
+    ASSERT_EQ(arena.buffer(frame_id), arena.frame(frame_id)->buffer);
+    ASSERT_EQ(arena.frame(0) + frame_id, arena.frame(frame_id));
+  }
+  memset(arena.buffer(63), 1, PAGE_SIZE);
+}
+
+TEST_F(LRUBufferPoolTest, testResize) {
+  LRUBufferPool pool(8, nullptr, ReplacerPolicy::kLRU, 32);
+  for (int i = 0; i < 8; i++) {
+    WritePageGuard guard(&pool, Position(i));
+    string data = "page" + to_string(i);
+    memcpy(guard.data(), data.c_str(), data.size() + 1);
+  }
+
+  // 扩容后8个页面仍在缓冲池中, 新增的帧直接使用
+  ASSERT_EQ(32, pool.Resize(64));
+  vector<Frame *> frames;
+  for (int i = 0; i < 32; i++) {
+    frames.emplace_back(pool.FetchPage(Position(i)));
+    ASSERT_NE(nullptr, frames.back());
+  }
+  ASSERT_EQ(nullptr, pool.FetchPage(Position(32)));
+  for (int i = 0; i < 32; i++) {
+    pool.UnPinPage(Position(i));
+  }
+
+  // 缩容时并发读取, 被移出的脏页写回后仍能读到
+  std::atomic<int> mismatch = 0;
+  std::thread reader([&] {
+    for (int round = 0; round < 20; round++) {
+      for (int i = 0; i < 8; i++) {
+        ReadPageGuard guard(&pool, Position(i));
+        if (!guard.valid() || "page" + to_string(i) != string(guard.data())) {
+          mismatch++;
+        }
+      }
+    }
+  });
+  ASSERT_EQ(4, pool.Resize(4));
+  reader.join();
+  ASSERT_EQ(0, mismatch);
+  ASSERT_EQ(4, pool.capacity());
+
+  for (int i = 0; i < 8; i++) {
+    ReadPageGuard guard(&pool, Position(i));
+    ASSERT_EQ("page" + to_string(i), string(guard.data()));
+  }
+}
+
+TEST_F(LRUBufferPoolTest, testResizeWithPinnedFrame) {
+  LRUBufferPool pool(16);
+  vector<Frame *> frames;
+  for (int i = 0; i < 16; i++) {
+    frames.emplace_back(pool.FetchPage(Position(i)));
+    ASSERT_NE(nullptr, frames.back());
+  }
+  // 第10帧上的页面一直被固定, 其余页面解除固定
+  int pinned = -1;
+  for (int i = 0; i < 16; i++) {
+    if (frames[i]->id == 10) {
+      pinned = i;
+    } else {
+      pool.UnPinPage(Position(i));
+    }
+  }
+  ASSERT_NE(-1, pinned);
+
+  // 缩容停在被固定的帧之后, 保留的帧仍能使用
+  ASSERT_EQ(11, pool.Resize(4));
+  ASSERT_EQ(11, pool.capacity());
+  for (int i = 100; i < 110; i++) {
+    ASSERT_NE(nullptr, pool.FetchPage(Position(i)));
+  }
+  ASSERT_EQ(nullptr, pool.FetchPage(Position(110)));
+  for (int i = 100; i < 110; i++) {
+    pool.UnPinPage(Position(i));
+  }
+
+  // 解除固定后可以继续缩容
+  pool.UnPinPage(Position(pinned));
+  ASSERT_EQ(4, pool.Resize(4));
+}
+
+TEST_F(LRUBufferPoolTest, testWarmup) {
+  string warmup_file = space_ + ".warmup";
+  std::remove(warmup_file.c_str());
+  {
+    // 析构时刷盘并保存预热文件, 最后访问的4个页面最热
+    LRUBufferPool pool(16);
+    pool.EnableWarmup(warmup_file);
+    for (int i = 0; i < 16; i++) {
+      WritePageGuard guard(&pool, Position(i));
+      string data = "warm" + to_string(i);
+      memcpy(guard.data(), data.c_str(), data.size() + 1);
+    }
+    for (int i = 12; i < 16; i++) {
+      ReadPageGuard guard(&pool, Position(i));
+    }
+  }
+
+  LRUBufferPool pool(4);
+  ASSERT_EQ(4, pool.LoadWarmupFile(warmup_file));
+
+  // 覆盖磁盘上的页面, 预热过的页面仍从缓冲池读到原来的内容
+  char buffer[PAGE_SIZE] = "stale";
+  for (int i = 12; i < 16; i++) {
+    TableSpaceDiskManager::Instance()->write(
+        space_id_, Position(i).page_address, buffer, PAGE_SIZE);
+  }
+  for (int i = 12; i < 16; i++) {
+    ReadPageGuard guard(&pool, Position(i));
+    ASSERT_EQ("warm" + to_string(i), string(guard.data()));
+  }
+  std::remove(warmup_file.c_str());
+}
+
+TEST(PageTableTest, testInsertErase) {
+  // 同一表空间的页地址低位全为0, 检查混合哈希后的探测和删除后的前移
+  PageTable table(64);
+  auto position = [](int page_no) {
+    return PagePosition{1, static_cast<address_t>(page_no) * PAGE_SIZE};
+  };
+  for (int i = 0; i < 64; i++) {
+    table.Insert(position(i), i);
+  }
+  ASSERT_EQ(64, table.size());
+  for (int i = 0; i < 64; i += 2) {
+    ASSERT_TRUE(table.Erase(position(i), i));
+  }
+  // 映射到其他帧时不删除
+  ASSERT_FALSE(table.Erase(position(1), 2));
+  ASSERT_EQ(32, table.size());
+  for (int i = 0; i < 64; i++) {
+    ASSERT_EQ(i % 2 ? i : PageTable::INVALID_FRAME, table.Find(position(i)));
+  }
+  table.Insert(position(1), 100);
+  ASSERT_EQ(100, table.Find(position(1)));
+  ASSERT_EQ(PageTable::INVALID_FRAME,
+            table.Find(PagePosition{2, PAGE_SIZE}));
+}
+
+TEST_F(LRUBufferPoolTest, testLockFreeHit) {
+  WritePages(12, "page");
+
+  // 命中不加锁, 与缺页淘汰并发时核对帧上的页面
+  LRUBufferPool pool(8, nullptr, ReplacerPolicy::kClock);
+  std::atomic<int> mismatch = 0;
+  vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 5000; i++) {
+        int page_no = (i % 10 == 0) ? 8 + (i / 10 + t) % 4 : (i + t) % 8;
+        ReadPageGuard guard(&pool, Position(page_no));
+        if (!guard.valid()) {
+          continue;
+        }
+        if ("page" + to_string(page_no) != string(guard.data()) ||
+            guard.frame()->page_position.page_address !=
+                Position(page_no).page_address) {
+          mismatch++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, mismatch);
+}
+
+TEST_F(ShardedBufferPoolTest, testReadPageOptimistic) {
+  vector<char> buffer(PAGE_SIZE);
+  ASSERT_FALSE(CopyPageOptimistic(pool_, Position(0), buffer.data()));
+  {
+    WritePageGuard guard(pool_, Position(0));
+    memset(guard.data(), 'a', PAGE_SIZE);
+    // 写者持有排他锁时乐观读失败
+    ASSERT_FALSE(CopyPageOptimistic(pool_, Position(0), buffer.data()));
+  }
+  ASSERT_TRUE(CopyPageOptimistic(pool_, Position(0), buffer.data()));
+  ASSERT_EQ(string(PAGE_SIZE, 'a'), string(buffer.data(), PAGE_SIZE));
+
+  // 写者不断整页改写, 乐观读成功时读到的页面不能是改写到一半的
+  std::atomic<bool> stop = false;
+  std::atomic<int> torn = 0;
+  std::atomic<int> succeeded = 0;
+  vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      vector<char> copy(PAGE_SIZE);
+      while (!stop) {
+        if (!CopyPageOptimistic(pool_, Position(0), copy.data())) {
+          // 与写者冲突时让出处理器, 单核上写者才能继续
+          std::this_thread::yield();
+          continue;
+        }
+        succeeded++;
+        if (std::count(copy.begin(), copy.end(), copy[0]) != PAGE_SIZE) {
+          torn++;
+        }
+      }
+    });
+  }
+  // 至少有一次乐观读成功后才停止改写, 超过期限时不再等待
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  for (int i = 0;
+       (i < 2000 || succeeded == 0) && std::chrono::steady_clock::now() < deadline;
+       i++) {
+    {
+      WritePageGuard guard(pool_, Position(0));
+      memset(guard.data(), 'a' + i % 26, PAGE_SIZE);
+    }
+    std::this_thread::yield();
+  }
+  stop = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(0, torn);
+  ASSERT_LT(0, succeeded);
+}
+
+TEST_F(LRUBufferPoolTest, testScanRing) {
+  WritePages(8, "page");
+  LRUBufferPool pool(32);
+  vector<char> buffer(PAGE_SIZE);
+  for (int i = 0; i < 8; i++) {
+    ReadPageGuard guard(&pool, Position(i));
+  }
+
+  {
+    // 每个缓冲池中环的帧数量不超过容量的 1/8
+    ScanRing ring(&pool);
+    std::unordered_set<Frame *> frames;
+    for (int i = 100; i < 200; i++) {
+      ReadPageGuard guard(&pool, Position(i), &ring);
+      ASSERT_TRUE(guard.valid());
+      frames.insert(guard.frame());
+    }
+    ASSERT_GE(4, frames.size());
+    // 扫描没有淘汰之前的页面
+    for (int i = 0; i < 8; i++) {
+      ASSERT_TRUE(CopyPageOptimistic(&pool, Position(i), buffer.data()));
+    }
+  }
+  // 扫描结束后环中的页面被放回空闲列表
+  ASSERT_FALSE(CopyPageOptimistic(&pool, Position(199), buffer.data()));
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(CopyPageOptimistic(&pool, Position(i), buffer.data()));
+    ASSERT_EQ("page" + to_string(i), string(buffer.data()));
+  }
+
+  // 扫描环中被其他访问命中过的页面离开环后留在缓冲池中
+  {
+    ScanRing ring(&pool);
+    for (int i = 300; i < 310; i++) {
+      ReadPageGuard guard(&pool, Position(i), &ring);
+      if (i == 305) {
+        ReadPageGuard hit(&pool, Position(i));
+      }
+    }
+  }
+  ASSERT_TRUE(CopyPageOptimistic(&pool, Position(305), buffer.data()));
+}
+
+struct SharedFrameTestData {
+  int a;
+  int b;
+};
+
+TEST_F(ShardedBufferPoolTest, testSharedFrameData) {
+  SharedFrameData<SharedFrameTestData> data(pool_, Position(1), 1, 2);
+  Frame *frame = data.frame();
+  ASSERT_EQ(1, data.reference_count());
+  ASSERT_EQ(1, frame->pin_count);
+
+  // 拷贝和移动只改变引用计数, 页面只固定一次
+  vector<SharedFrameData<SharedFrameTestData>> copies(4, data);
+  ASSERT_EQ(5, data.reference_count());
+  SharedFrameData<SharedFrameTestData> moved = std::move(copies.back());
+  copies.pop_back();
+  ASSERT_EQ(5, data.reference_count());
+  ASSERT_EQ(1, frame->pin_count);
+
+  vector<std::thread> threads;
+  for (auto &copy : copies) {
+    threads.emplace_back([handle = std::move(copy)]() mutable {
+      for (int i = 0; i < 1000; i++) {
+        SharedFrameData<SharedFrameTestData> local = handle;
+        ASSERT_EQ(2, local->b);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(2, data.reference_count());
+
+  data = SharedFrameData<SharedFrameTestData>();
+  ASSERT_EQ(1, moved.reference_count());
+  ASSERT_EQ(1, frame->pin_count);
+  moved = SharedFrameData<SharedFrameTestData>();
+  ASSERT_EQ(0, frame->pin_count);
+}
+
+TEST_F(LRUBufferPoolTest, testSharedFrameDataWithoutFrame) {
+  LRUBufferPool pool(1);
+  Frame *pinned = pool.FetchPage(Position(0));
+  ASSERT_NE(nullptr, pinned);
+
+  // 没有可用的帧时句柄为空, 拷贝和析构不解除其他页面的固定
+  {
+    SharedFrameData<SharedFrameTestData> data(&pool, Position(1), 1, 2);
+    ASSERT_FALSE(data.valid());
+    ASSERT_EQ(nullptr, data.frame());
+    ASSERT_EQ(0, data.reference_count());
+    SharedFrameData<SharedFrameTestData> copy = data;
+    ASSERT_FALSE(copy.valid());
+  }
+  ASSERT_EQ(1, pinned->pin_count);
+  pool.UnPinPage(Position(0));
+
+  SharedFrameData<SharedFrameTestData> data(&pool, Position(1), 1, 2);
+  ASSERT_TRUE(data.valid());
+  ASSERT_EQ(2, data->b);
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <sys/uio.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "basetype.h"
+#include "file.h"
+
+using std::string;
+using std::vector;
+
+class FileTest : public ::testing::Test {
+ protected:
+  void SetUp() override { std::remove(path_.c_str()); }
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  string path_ = "file_test.data";
+};
+
+TEST_F(FileTest, testReadPastEnd) {
+  File file(path_);
+  ASSERT_TRUE(file.is_open());
+  string data(100, 'a');
+  ASSERT_EQ(100, file.write(size_t{0}, data.data(), data.size()));
+
+  // 跨过文件尾的部分填充0, 返回值只计算从文件读到的部分
+  string buffer(200, 'x');
+  ASSERT_EQ(100, file.read(size_t{0}, buffer.data(), buffer.size()));
+  ASSERT_EQ(data + string(100, '\0'), buffer);
+
+  // 完全在文件尾之后
+  buffer.assign(200, 'x');
+  ASSERT_EQ(0, file.read(size_t{1000}, buffer.data(), buffer.size()));
+  ASSERT_EQ(string(200, '\0'), buffer);
+}
+
+TEST_F(FileTest, testCachedSize) {
+  {
+    File file(path_);
+    ASSERT_EQ(0, file.size());
+    string data(10, 'b');
+    ASSERT_EQ(10, file.write(size_t{4096}, data.data(), data.size()));
+    ASSERT_EQ(4106, file.size());
+    // 写入文件中间不改变长度
+    ASSERT_EQ(10, file.write(size_t{0}, data.data(), data.size()));
+    ASSERT_EQ(4106, file.size());
+    // 空洞读出为0
+    string buffer(10, 'x');
+    ASSERT_EQ(10, file.read(size_t{100}, buffer.data(), buffer.size()));
+    ASSERT_EQ(string(10, '\0'), buffer);
+  }
+
+  // 重新打开时从文件读取长度
+  File file(path_);
+  ASSERT_EQ(4106, file.size());
+}
+
+TEST_F(FileTest, testVectoredIO) {
+  File file(path_);
+  string first(512, '1');
+  string second(512, '2');
+  iovec iov[2] = {{first.data(), first.size()}, {second.data(), second.size()}};
+  ASSERT_EQ(1024, file.writev(size_t{512}, iov, 2));
+  ASSERT_EQ(1536, file.size());
+
+  // 第二个缓冲区只有前 256 字节在文件内
+  string out1(512, 'x');
+  string out2(1024, 'x');
+  iovec out[2] = {{out1.data(), out1.size()}, {out2.data(), out2.size()}};
+  ASSERT_EQ(768, file.readv(size_t{768}, out, 2));
+  ASSERT_EQ(string(256, '1') + string(256, '2'), out1);
+  ASSERT_EQ(string(256, '2') + string(768, '\0'), out2);
+}
+
+TEST_F(FileTest, testConcurrentWrite) {
+  File file(path_);
+  const int threads = 8;
+  const int blocks = 64;
+  const size_t block_size = 512;
+
+  // 各线程交错写入不同位置, pwrite 不依赖共享的文件偏移量
+  vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      string data(block_size, 'a' + t);
+      for (int i = 0; i < blocks; i++) {
+        size_t pos = (i * threads + t) * block_size;
+        ASSERT_EQ(block_size, file.write(pos, data.data(), data.size()));
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  ASSERT_EQ(threads * blocks * block_size, file.size());
+
+  string buffer(block_size, 'x');
+  for (int i = 0; i < threads * blocks; i++) {
+    ASSERT_EQ(block_size,
+              file.read(i * block_size, buffer.data(), buffer.size()));
+    ASSERT_EQ(string(block_size, 'a' + i % threads), buffer);
+  }
+}
+
+TEST_F(FileTest, testDirectIO) {
+  File file(path_, true);
+  ASSERT_TRUE(file.is_open());
+  ASSERT_TRUE(file.is_direct_io());
+
+  // 对齐的读写直接下发
+  char *block = static_cast<char *>(aligned_alloc(IO_BLOCK_SIZE, IO_BLOCK_SIZE));
+  memset(block, 'a', IO_BLOCK_SIZE);
+  ASSERT_EQ(IO_BLOCK_SIZE, file.write(size_t{IO_BLOCK_SIZE}, block,
+                                      IO_BLOCK_SIZE));
+  ASSERT_EQ(2 * IO_BLOCK_SIZE, file.size());
+  memset(block, 'x', IO_BLOCK_SIZE);
+  ASSERT_EQ(IO_BLOCK_SIZE, file.read(size_t{0}, block, IO_BLOCK_SIZE));
+  ASSERT_EQ(string(IO_BLOCK_SIZE, '\0'), string(block, IO_BLOCK_SIZE));
+  free(block);
+
+  // 未对齐的写入经过中转缓冲区读改写, 同一块中的其他数据保持不变
+  string data = "unaligned";
+  ASSERT_EQ(data.size(), file.write(size_t{IO_BLOCK_SIZE + 100}, data.data(),
+                                    data.size()));
+  ASSERT_EQ(2 * IO_BLOCK_SIZE, file.size());
+  string buffer(120, 'x');
+  ASSERT_EQ(buffer.size(), file.read(size_t{IO_BLOCK_SIZE + 90},
+                                     buffer.data(), buffer.size()));
+  ASSERT_EQ(string(10, 'a') + data + string(101, 'a'), buffer);
+
+  // 跨过文件尾的未对齐写入扩展文件, 读出时文件尾之后填充0
+  ASSERT_EQ(data.size(), file.write(size_t{2 * IO_BLOCK_SIZE + 1},
+                                    data.data(), data.size()));
+  buffer.assign(20, 'x');
+  ASSERT_EQ(buffer.size(), file.read(size_t{2 * IO_BLOCK_SIZE}, buffer.data(),
+                                     buffer.size()));
+  ASSERT_EQ(string(1, '\0') + data + string(10, '\0'), buffer);
+}
+
+TEST_F(FileTest, testDirectIOConcurrentUnalignedWrite) {
+  File file(path_, true);
+  ASSERT_TRUE(file.is_direct_io());
+
+  // 多个线程写入同一块的不同位置, 读改写串行化后互不覆盖
+  const int threads = 8;
+  const size_t size = 64;
+  vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      string data(size, 'a' + t);
+      for (int i = 0; i < 100; i++) {
+        file.write(t * size, data.data(), data.size());
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  string buffer(threads * size, 'x');
+  ASSERT_EQ(buffer.size(), file.read(size_t{0}, buffer.data(), buffer.size()));
+  for (int t = 0; t < threads; t++) {
+    ASSERT_EQ(string(size, 'a' + t), buffer.substr(t * size, size));
+  }
+}
+
+TEST_F(FileTest, testDirectIOFallback) {
+  // procfs 不支持 O_DIRECT, 打开时返回 EINVAL, 退回到带缓存的I/O
+  File file("/proc/self/comm", true);
+  ASSERT_TRUE(file.is_open());
+  ASSERT_FALSE(file.is_direct_io());
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "io/IOUringSpaceManager.h"
+#include "io/TableSpaceRegistry.h"
+
+using std::future;
+using std::string;
+using std::vector;
+
+class IOUringSpaceManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::remove(space_.c_str());
+    manager_ = new IOUringSpaceManager(8, 4);
+  }
+
+  void TearDown() override { delete manager_; }
+
+  IOUringSpaceManager *manager_;
+  string space_ = "io_uring_test.space";
+  space_t space_id_ = TableSpaceRegistry::Instance()->Register(space_);
+  int page_count_ = 32;
+};
+
+TEST_F(IOUringSpaceManagerTest, testAsyncWriteAndRead) {
+  vector<vector<char>> pages(page_count_, vector<char>(PAGE_SIZE));
+  vector<future<size_t>> results;
+  for (int i = 0; i < page_count_; i++) {
+    memset(pages[i].data(), 'a' + i % 26, PAGE_SIZE);
+    results.emplace_back(manager_->AsyncWrite(space_id_, i * PAGE_SIZE,
+                                              pages[i].data(), PAGE_SIZE));
+  }
+  manager_->Submit();
+  for (auto &result : results) {
+    ASSERT_EQ(PAGE_SIZE, result.get());
+  }
+
+  int callbacks = 0;
+  vector<char> buffer(PAGE_SIZE * page_count_);
+  results.clear();
+  for (int i = 0; i < page_count_; i++) {
+    results.emplace_back(
+        manager_->AsyncRead(space_id_, i * PAGE_SIZE,
+                            buffer.data() + i * PAGE_SIZE, PAGE_SIZE,
+                            [&](size_t size) {
+                              if (size == PAGE_SIZE) {
+                                callbacks++;
+                              }
+                            }));
+  }
+  manager_->Submit();
+  for (auto &result : results) {
+    ASSERT_EQ(PAGE_SIZE, result.get());
+  }
+  ASSERT_EQ(page_count_, callbacks);
+  for (int i = 0; i < page_count_; i++) {
+    ASSERT_EQ(0, memcmp(pages[i].data(), buffer.data() + i * PAGE_SIZE,
+                        PAGE_SIZE));
+  }
+}
+
+TEST_F(IOUringSpaceManagerTest, testReadPastEndOfFile) {
+  // 表空间文件由 TableSpaceDiskManager 缓存, 使用独立的表空间
+  string space = "io_uring_test_eof.space";
+  std::remove(space.c_str());
+  vector<char> buffer(PAGE_SIZE, 'x');
+  space_t space_id = TableSpaceRegistry::Instance()->Register(space);
+  ASSERT_EQ(0,
+            manager_->read(space_id, PAGE_SIZE * 4, buffer.data(), PAGE_SIZE));
+  ASSERT_EQ(vector<char>(PAGE_SIZE, 0), buffer);
+}
+
+TEST_F(IOUringSpaceManagerTest, testReadAcrossEndOfFile) {
+  // 读到文件尾时返回已读的字节数, 剩余部分填0
+  string space = "io_uring_test_short.space";
+  std::remove(space.c_str());
+  space_t space_id = TableSpaceRegistry::Instance()->Register(space);
+  vector<char> half(PAGE_SIZE / 2, 'a');
+  ASSERT_EQ(PAGE_SIZE / 2,
+            manager_->write(space_id, PAGE_SIZE, half.data(), half.size()));
+
+  vector<char> buffer(PAGE_SIZE, 'x');
+  ASSERT_EQ(PAGE_SIZE / 2,
+            manager_->read(space_id, PAGE_SIZE, buffer.data(), PAGE_SIZE));
+  ASSERT_EQ(0, memcmp(half.data(), buffer.data(), half.size()));
+  ASSERT_EQ(vector<char>(PAGE_SIZE / 2, 0),
+            vector<char>(buffer.begin() + PAGE_SIZE / 2, buffer.end()));
+}
+
+TEST(TableSpaceRegistryTest, testRegister) {
+  auto registry = TableSpaceRegistry::Instance();
+  space_t space = registry->Register("registry_test.space");
+  ASSERT_EQ(space, registry->Register("registry_test.space"));
+  ASSERT_NE(space, registry->Register("registry_test_other.space"));
+  ASSERT_EQ("registry_test.space", registry->Name(space));
+  ASSERT_LT(space, registry->size());
+  ASSERT_EQ("", registry->Name(TableSpaceRegistry::INVALID_SPACE));
+}
+
+TEST(TableSpaceRegistryTest, testPageSize) {
+  auto registry = TableSpaceRegistry::Instance();
+  space_t space = registry->Register("registry_page_size_test.space");
+  ASSERT_EQ(PAGE_SIZE, registry->PageSize(space));
+  ASSERT_TRUE(registry->SetPageSize(space, 4 * 1024));
+  ASSERT_EQ(4 * 1024, registry->PageSize(space));
+  ASSERT_FALSE(registry->SetPageSize(space, 6 * 1024));
+  ASSERT_FALSE(registry->SetPageSize(space, 128 * 1024));
+  ASSERT_EQ(4 * 1024, registry->PageSize(space));
+  ASSERT_EQ(PAGE_SIZE, registry->PageSize(TableSpaceRegistry::INVALID_SPACE));
+}
@@ -26,3 +26,155 @@ TEST_F(LRUReplacerTest, testEvict) {
     ASSERT_EQ(i, result.value());
   }
 }
+
+class ClockReplacerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    capacity_ = 10;
+    replacer_ = new ClockReplacer(capacity_);
+
+    for (int i = 0; i < capacity_; i++) {
+      replacer_->Unpin(i);
+    }
+  }
+  void TearDown() override { delete replacer_; }
+
+ protected:
+  IReplacer *replacer_;
+  int capacity_;
+};
+
+TEST_F(ClockReplacerTest, testEvict) {
+  ASSERT_EQ(capacity_, replacer_->size());
+  for (int i = 0; i < capacity_; i++) {
+    optional<frame_id_t> result = replacer_->Victim();
+    ASSERT_EQ(true, result.has_value());
+    ASSERT_EQ(i, result.value());
+  }
+  ASSERT_EQ(0, replacer_->size());
+  ASSERT_EQ(false, replacer_->Victim().has_value());
+}
+
+TEST_F(ClockReplacerTest, testSecondChance) {
+  // 淘汰0号帧后, 其余帧的引用位已被清除
+  ASSERT_EQ(0, replacer_->Victim().value());
+  replacer_->Pin(1);
+  replacer_->Unpin(2);
+  ASSERT_EQ(8, replacer_->size());
+
+  // 1号帧被固定不可淘汰, 2号帧重新获得引用位
+  ASSERT_EQ(3, replacer_->Victim().value());
+  ASSERT_EQ(4, replacer_->Victim().value());
+}
+
+class LRUKReplacerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    capacity_ = 10;
+    replacer_ = new LRUKReplacer(capacity_, 2);
+  }
+  void TearDown() override { delete replacer_; }
+
+ protected:
+  IReplacer *replacer_;
+  int capacity_;
+};
+
+TEST_F(LRUKReplacerTest, testScanResistant) {
+  // 前一半帧访问两次, 模拟常驻的内部页
+  for (int i = 0; i < capacity_ / 2; i++) {
+    replacer_->RecordAccess(i);
+    replacer_->RecordAccess(i);
+  }
+  // 后一半帧只被扫描访问一次, 且访问时间更晚
+  for (int i = capacity_ / 2; i < capacity_; i++) {
+    replacer_->RecordAccess(i);
+  }
+  for (int i = 0; i < capacity_; i++) {
+    replacer_->Unpin(i);
+  }
+  ASSERT_EQ(capacity_, replacer_->size());
+
+  for (int i = capacity_ / 2; i < capacity_; i++) {
+    ASSERT_EQ(i, replacer_->Victim().value());
+  }
+  for (int i = 0; i < capacity_ / 2; i++) {
+    ASSERT_EQ(i, replacer_->Victim().value());
+  }
+  ASSERT_EQ(false, replacer_->Victim().has_value());
+}
+
+TEST_F(LRUKReplacerTest, testPin) {
+  for (int i = 0; i < capacity_; i++) {
+    replacer_->RecordAccess(i);
+    replacer_->Unpin(i);
+  }
+  replacer_->Pin(0);
+  ASSERT_EQ(capacity_ - 1, replacer_->size());
+  ASSERT_EQ(1, replacer_->Victim().value());
+
+  // 被淘汰的帧清空历史, 重新装入的页面按新页面计算
+  replacer_->RecordAccess(1);
+  replacer_->Unpin(1);
+  replacer_->Unpin(0);
+  ASSERT_EQ(0, replacer_->Victim().value());
+}
+
+class ARCReplacerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    capacity_ = 4;
+    replacer_ = new ARCReplacer(capacity_);
+
+    for (int i = 0; i < capacity_; i++) {
+      replacer_->RecordLoad(i, Position(i));
+      replacer_->Unpin(i);
+    }
+  }
+  void TearDown() override { delete replacer_; }
+
+  PagePosition Position(int page_no) {
+    return {0, page_no * PAGE_SIZE};
+  }
+
+ protected:
+  ARCReplacer *replacer_;
+  int capacity_;
+};
+
+TEST_F(ARCReplacerTest, testScanResistant) {
+  // 0号帧再次访问进入频繁列表
+  replacer_->Pin(0);
+  replacer_->RecordAccess(0);
+  replacer_->Unpin(0);
+
+  // 扫描新页面只淘汰近期列表中的帧
+  for (int page_no = 100; page_no < 120; page_no++) {
+    auto victim = replacer_->Victim();
+    ASSERT_EQ(true, victim.has_value());
+    ASSERT_NE(0, victim.value());
+    replacer_->RecordLoad(victim.value(), Position(page_no));
+    replacer_->Unpin(victim.value());
+  }
+}
+
+TEST_F(ARCReplacerTest, testGhostHitAdapts) {
+  ASSERT_EQ(0, replacer_->recency_target());
+
+  // 近期列表淘汰的页面再次缺页, 增大近期列表的目标长度
+  frame_id_t frame_id = replacer_->Victim().value();
+  ASSERT_EQ(0, frame_id);
+  replacer_->RecordLoad(frame_id, Position(0));
+  replacer_->Unpin(frame_id);
+  ASSERT_EQ(1, replacer_->recency_target());
+
+  // 近期列表不超过目标长度时淘汰频繁列表, 再次缺页时减小目标长度
+  for (int i = 1; i < capacity_; i++) {
+    replacer_->RecordAccess(i);
+  }
+  frame_id = replacer_->Victim().value();
+  ASSERT_EQ(0, frame_id);
+  replacer_->RecordLoad(frame_id, Position(0));
+  replacer_->Unpin(frame_id);
+  ASSERT_EQ(0, replacer_->recency_target());
+}
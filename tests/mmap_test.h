@@ -0,0 +1,95 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "basetype.h"
+#include "buffer/mmap_buffer_pool.h"
+#include "file.h"
+#include "io/MMapSpaceManager.h"
+#include "io/TableSpaceRegistry.h"
+
+using std::string;
+
+class MMapBufferPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // 映射按表空间缓存且不会更新, 每个测试使用独立的表空间
+    path_ = string("mmap_buffer_pool_test_") +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name() +
+            ".space";
+    std::remove(path_.c_str());
+    space_ = TableSpaceRegistry::Instance()->Register(path_);
+  }
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  /**
+   * @brief 按 TableSpaceDiskManager 之外的方式写入页面, 每页填充一个字符
+   */
+  void WritePages(int count) {
+    File file(path_);
+    ASSERT_TRUE(file.is_open());
+    for (int i = 0; i < count; i++) {
+      string page(PAGE_SIZE, 'a' + i);
+      ASSERT_EQ(PAGE_SIZE, file.write(size_t(i * PAGE_SIZE), page.data(),
+                                      page.size()));
+    }
+  }
+
+  PagePosition Position(int i) { return {space_, i * PAGE_SIZE}; }
+
+  string path_;
+  space_t space_;
+};
+
+TEST_F(MMapBufferPoolTest, testFetchPage) {
+  // 文件不存在时映射失败, 写入后重试映射
+  MMapBufferPool pool;
+  ASSERT_EQ(nullptr, pool.FetchPage(Position(0)));
+  WritePages(4);
+
+  for (int i = 0; i < 4; i++) {
+    Frame *frame = pool.FetchPage(Position(i));
+    ASSERT_NE(nullptr, frame);
+    ASSERT_EQ(string(PAGE_SIZE, 'a' + i), string(frame->buffer, PAGE_SIZE));
+    ASSERT_EQ(frame->buffer,
+              MMapSpaceManager::Instance()->Address(space_, i * PAGE_SIZE,
+                                                    PAGE_SIZE));
+    pool.UnPinPage(Position(i));
+  }
+  ASSERT_EQ(nullptr, pool.FetchPage(Position(4)));
+}
+
+TEST_F(MMapBufferPoolTest, testPinCount) {
+  WritePages(1);
+  MMapBufferPool pool;
+  Frame *frame = pool.FetchPage(Position(0));
+  ASSERT_NE(nullptr, frame);
+  ASSERT_EQ(frame, pool.FetchPage(Position(0)));
+  ASSERT_EQ(2, frame->pin_count);
+
+  // 固定计数降为0后帧被释放, 再次获取时重新创建
+  pool.UnPinPage(Position(0));
+  ASSERT_EQ(1, frame->pin_count);
+  frame_id_t frame_id = frame->id;
+  pool.UnPinPage(Position(0));
+  ASSERT_FALSE(pool.FlushPage(Position(0)));
+  frame = pool.FetchPage(Position(0));
+  ASSERT_NE(nullptr, frame);
+  ASSERT_NE(frame_id, frame->id);
+  pool.UnPinPage(Position(0));
+}
+
+TEST_F(MMapBufferPoolTest, testReadOnly) {
+  WritePages(2);
+  auto manager = MMapSpaceManager::Instance();
+  string buffer(PAGE_SIZE, 'x');
+  ASSERT_EQ(0, manager->write(space_, 0, buffer.data(), buffer.size()));
+
+  // 跨过映射末尾的读取只返回映射内的部分, 其余填0
+  ASSERT_EQ(PAGE_SIZE / 2, manager->read(space_, PAGE_SIZE * 3 / 2,
+                                         buffer.data(), buffer.size()));
+  ASSERT_EQ(string(PAGE_SIZE / 2, 'b') + string(PAGE_SIZE / 2, '\0'), buffer);
+}
@@ -149,6 +149,23 @@ TEST_F(PageTest, testLowerBound) {
   ASSERT_EQ(expected_key3, record3.key);
 }
 
+TEST_F(PageTest, testOptimisticLowerBound) {
+  RecordData record;
+  auto key = "key" + to_string(start_record_no + 10);
+  ASSERT_TRUE(page_->OptimisticLowerBound(PAGE_SIZE, key, cmp, &record));
+  ASSERT_EQ(key, record.key);
+  ASSERT_EQ("val10", record.val);
+
+  // 页面大小与元数据不符时放弃
+  ASSERT_FALSE(page_->OptimisticLowerBound(PAGE_SIZE / 2, key, cmp, &record));
+
+  // 写者修改到一半的页面中偏移量可能越界, 只能放弃而不能越界读取
+  string garbage(PAGE_SIZE, '\xff');
+  memcpy(garbage.data(), page_->base_address(), sizeof(PageMeta));
+  const Page torn = Page::ReadOnly(PageType::kLeafPage, garbage.data());
+  ASSERT_FALSE(torn.OptimisticLowerBound(PAGE_SIZE, key, cmp, &record));
+}
+
 TEST_F(PageTest, testBeginIterator) {
   auto iter = page_->Iterator();
   ASSERT_EQ(true, iter.isVirtualRecord());